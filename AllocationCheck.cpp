@@ -0,0 +1,113 @@
+#include "AllocationCheck.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<bool> armed{ false };
+std::atomic<size_t> allocationCount{ 0 };
+thread_local bool checkedThread = false;
+thread_local int pauseDepth = 0;
+}
+
+bool allocationCheckAvailable() {
+    return LOTUS_CHECK_ALLOCATIONS != 0;
+}
+
+void checkAllocationsOnThisThread() {
+    checkedThread = true;
+}
+
+void armAllocationCheck() {
+    allocationCount = 0;
+    armed = true;
+}
+
+void disarmAllocationCheck() {
+    armed = false;
+}
+
+size_t checkedAllocations() {
+    return allocationCount.load();
+}
+
+AllocationCheckPause::AllocationCheckPause() {
+    ++pauseDepth;
+}
+
+AllocationCheckPause::~AllocationCheckPause() {
+    --pauseDepth;
+}
+
+#if LOTUS_CHECK_ALLOCATIONS
+
+namespace {
+
+void noteAllocation(size_t size) {
+    if (!checkedThread || pauseDepth > 0 || !armed.load(std::memory_order_relaxed))
+        return;
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    ++pauseDepth;
+    std::fprintf(stderr, "Steady-state frame allocated %zu bytes\n", size);
+    std::abort();
+}
+
+void* allocate(size_t size) {
+    noteAllocation(size);
+    void* p = std::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* allocateAligned(size_t size, size_t alignment) {
+    noteAllocation(size);
+    size = (size + alignment - 1) / alignment * alignment;
+#ifdef _MSC_VER
+    void* p = _aligned_malloc(size ? size : alignment, alignment);
+#else
+    void* p = std::aligned_alloc(alignment, size ? size : alignment);
+#endif
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void freeAligned(void* p) {
+#ifdef _MSC_VER
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void* operator new(size_t size, std::align_val_t a) { return allocateAligned(size, (size_t)a); }
+void* operator new[](size_t size, std::align_val_t a) { return allocateAligned(size, (size_t)a); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    noteAllocation(size);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    noteAllocation(size);
+    return std::malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { freeAligned(p); }
+
+#endif
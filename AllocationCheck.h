@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+
+// Debug check that the steady-state frame loop doesn't touch the heap. With
+// LOTUS_CHECK_ALLOCATIONS (on by default in builds without NDEBUG) global
+// operator new is replaced; once armed, any allocation on a thread that
+// opted in prints its size and aborts, so a debugger stops on the call.
+#ifndef LOTUS_CHECK_ALLOCATIONS
+#ifdef NDEBUG
+#define LOTUS_CHECK_ALLOCATIONS 0
+#else
+#define LOTUS_CHECK_ALLOCATIONS 1
+#endif
+#endif
+
+// False when the hook is compiled out; arming is then a no-op
+bool allocationCheckAvailable();
+
+// Opts the calling thread in. Workers streaming data in stay out.
+void checkAllocationsOnThisThread();
+
+void armAllocationCheck();
+void disarmAllocationCheck();
+
+// Allocations on opted-in threads since arming
+size_t checkedAllocations();
+
+// Lets a scope allocate on purpose (debug text, one-off resizes)
+class AllocationCheckPause {
+public:
+    AllocationCheckPause();
+    ~AllocationCheckPause();
+
+    AllocationCheckPause(const AllocationCheckPause&) = delete;
+    AllocationCheckPause& operator=(const AllocationCheckPause&) = delete;
+};
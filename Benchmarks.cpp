@@ -0,0 +1,724 @@
+#include "Benchmarks.h"
+#include "JobSystem.h"
+#include "CapsuleWorld.h"
+#include "CapsuleBroadphase.h"
+#include "CapsuleCollider.h"
+#include "GeometryClipmap.h"
+#include "TerrainRaycaster.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedNs(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+void benchJobs() {
+    JobSystem& jobs = JobSystem::instance();
+    const int N = 200000;
+    std::cout << "Job system: " << jobs.workerCount() << " workers\n";
+
+    // Empty jobs submitted from this thread, which isn't a worker
+    {
+        JobCounter counter;
+        auto start = Clock::now();
+        for (int i = 0; i < N; ++i)
+            jobs.run([] {}, &counter);
+        jobs.wait(counter);
+        std::cout << "  run + wait, external thread:  " << elapsedNs(start) / N << " ns/job\n";
+    }
+
+    // The same from inside a job, so they go on a worker's own deque
+    {
+        JobCounter outer;
+        double ns = 0.0;
+        jobs.run([&] {
+            JobCounter counter;
+            auto start = Clock::now();
+            for (int i = 0; i < N; ++i)
+                jobs.run([] {}, &counter);
+            jobs.wait(counter);
+            ns = elapsedNs(start);
+        }, &outer);
+        jobs.wait(outer);
+        std::cout << "  run + wait, worker deque:     " << ns / N << " ns/job\n";
+    }
+
+    // A chain where each job waits for the previous one
+    {
+        const int links = 20000;
+        std::vector<JobCounter> chain(links);
+        auto start = Clock::now();
+        jobs.run([] {}, &chain[0]);
+        for (int i = 1; i < links; ++i)
+            jobs.runAfter(chain[i - 1], [] {}, &chain[i]);
+        jobs.wait(chain[links - 1]);
+        std::cout << "  dependency chain:             " << elapsedNs(start) / links << " ns/link\n";
+    }
+
+    // parallelFor against a plain loop, for a light and a heavier body
+    for (int work : { 1, 256 }) {
+        const size_t items = 1 << 20;
+        std::vector<float> data(items, 1.0f);
+        auto body = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                float v = data[i];
+                for (int k = 0; k < work; ++k)
+                    v = v * 0.999f + 0.001f;
+                data[i] = v;
+            }
+        };
+        auto start = Clock::now();
+        body(0, items);
+        double serialNs = elapsedNs(start);
+        start = Clock::now();
+        jobs.parallelFor(0, items, 4096, body);
+        double parallelNs = elapsedNs(start);
+        std::cout << "  parallelFor, " << work << " ops/item:  " << serialNs / 1e6 << " ms serial, "
+            << parallelNs / 1e6 << " ms parallel (" << serialNs / parallelNs << "x)\n";
+    }
+
+    std::cout << "  executed " << jobs.jobsExecuted.load() << " jobs, " << jobs.steals.load() << " steals\n";
+}
+
+// Rolling hills on the same 256x256 cell, 10 m grid as the demo terrain
+HeightGrid makeBenchTerrain() {
+    HeightGrid terrain;
+    terrain.w = terrain.h = 257;
+    terrain.spacing = 10.0f;
+    terrain.heights.resize(size_t(terrain.w) * terrain.h);
+    for (int z = 0; z < terrain.h; ++z)
+        for (int x = 0; x < terrain.w; ++x)
+            terrain.heights[z * terrain.w + x] = 8.0f * std::sin(x * 0.07f) * std::cos(z * 0.05f) + 2.0f * std::sin(x * 0.31f + z * 0.23f);
+    return terrain;
+}
+
+// Agents dropped above the terrain, walking in random directions
+void fillBenchWorld(CapsuleWorld& world, const HeightGrid& terrain, size_t count) {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    world.clear();
+    world.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        float x = unit(rng) * terrain.extentX(), z = unit(rng) * terrain.extentZ();
+        float angle = unit(rng) * 6.2831853f, speed = 1.0f + 4.0f * unit(rng);
+        world.add(glm::vec3(x, terrain.sample(x, z) + 20.0f * unit(rng), z), 4.0f, 1.0f,
+            glm::vec3(std::cos(angle) * speed, 0.0f, std::sin(angle) * speed));
+    }
+}
+
+bool sameState(const CapsuleWorld& a, const CapsuleWorld& b) {
+    size_t bytes = a.size() * sizeof(float);
+    return std::memcmp(a.posX.data(), b.posX.data(), bytes) == 0 && std::memcmp(a.posY.data(), b.posY.data(), bytes) == 0
+        && std::memcmp(a.posZ.data(), b.posZ.data(), bytes) == 0 && std::memcmp(a.velX.data(), b.velX.data(), bytes) == 0
+        && std::memcmp(a.velY.data(), b.velY.data(), bytes) == 0 && std::memcmp(a.velZ.data(), b.velZ.data(), bytes) == 0
+        && std::memcmp(a.onGround.data(), b.onGround.data(), a.size()) == 0;
+}
+
+bool benchCapsules() {
+    const HeightGrid terrain = makeBenchTerrain();
+    const float dt = 1.0f / 60.0f;
+    std::cout << "Capsule world: " << CapsuleWorld::BATCH << "-wide batches, 60 Hz ticks on a "
+        << terrain.w << "x" << terrain.h << " heightfield\n";
+
+    bool ok = true;
+    for (size_t count : { 256, 4096, 65536 }) {
+        const int ticks = int(std::max<size_t>(60, (1 << 22) / count));
+        CapsuleWorld scalar, batched;
+        fillBenchWorld(scalar, terrain, count);
+        fillBenchWorld(batched, terrain, count);
+
+        auto start = Clock::now();
+        for (int t = 0; t < ticks; ++t)
+            scalar.stepScalar(dt, terrain);
+        double scalarMs = elapsedNs(start) * 1e-6;
+
+        start = Clock::now();
+        for (int t = 0; t < ticks; ++t)
+            batched.step(dt, terrain);
+        double batchedMs = elapsedNs(start) * 1e-6;
+
+        double steps = double(count) * ticks;
+        bool same = sameState(scalar, batched);
+        std::cout << "  " << count << " capsules x " << ticks << " ticks: "
+            << steps / scalarMs << " capsules/ms scalar, " << steps / batchedMs << " capsules/ms batched ("
+            << scalarMs / batchedMs << "x)" << (same ? "" : ", RESULTS DIFFER") << "\n";
+        ok = ok && same;
+    }
+    if (!ok)
+        std::cout << "  CHECK FAILED\n";
+    return ok;
+}
+
+// CapsuleCollider::update's old signature, as the baseline: the sampler is
+// wrapped in a std::function per call and reached through an indirect call
+void updateErased(CapsuleCollider& capsule, float dt, std::function<float(float, float)> getTerrainHeight) {
+    capsule.update(dt, getTerrainHeight);
+}
+
+template <typename Update>
+double timeColliders(const HeightGrid& terrain, int ticks, std::vector<CapsuleCollider>& colliders, Update update) {
+    std::mt19937 rng(99);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (CapsuleCollider& c : colliders) {
+        c.posX = unit(rng) * terrain.extentX();
+        c.posZ = unit(rng) * terrain.extentZ();
+        c.velocityY = 0.0f;
+        c.posY = terrain.sample(c.posX, c.posZ) + 10.0f * unit(rng);
+    }
+    auto start = Clock::now();
+    for (int t = 0; t < ticks; ++t) {
+        for (CapsuleCollider& c : colliders) {
+            c.moveHorizontal(0.05f, 0.03f);
+            update(c);
+        }
+    }
+    return elapsedNs(start) / (double(ticks) * colliders.size());
+}
+
+bool benchCollider() {
+    const HeightGrid terrain = makeBenchTerrain();
+    const float dt = 1.0f / 60.0f;
+    const int ticks = 256;
+    std::vector<CapsuleCollider> erased(4096, CapsuleCollider(0, 0, 0, 4.0f, 1.0f)), inlined = erased;
+
+    // The player's old nearest-sample getHeight and main's getInterpolatedHeight
+    auto nearest = [&terrain](float x, float z) {
+        int gx = std::clamp(int(x / terrain.spacing), 0, terrain.w - 1);
+        int gz = std::clamp(int(z / terrain.spacing), 0, terrain.h - 1);
+        return terrain.at(gx, gz);
+    };
+    auto bilinear = [&terrain](float x, float z) { return terrain.sample(x, z); };
+
+    std::cout << "CapsuleCollider::update, " << erased.size() << " colliders x " << ticks << " ticks\n";
+    bool ok = true;
+    auto report = [&](const char* sampler, double erasedNs, double inlinedNs) {
+        bool same = true;
+        for (size_t i = 0; i < erased.size(); ++i)
+            same = same && erased[i].posY == inlined[i].posY;
+        std::cout << "  " << sampler << ": " << erasedNs << " ns std::function, " << inlinedNs << " ns template ("
+            << erasedNs / inlinedNs << "x)" << (same ? "" : ", RESULTS DIFFER") << "\n";
+        ok = ok && same;
+    };
+    {
+        double erasedNs = timeColliders(terrain, ticks, erased, [&](CapsuleCollider& c) { updateErased(c, dt, nearest); });
+        double inlinedNs = timeColliders(terrain, ticks, inlined, [&](CapsuleCollider& c) { c.update(dt, nearest); });
+        report("nearest ", erasedNs, inlinedNs);
+    }
+    {
+        double erasedNs = timeColliders(terrain, ticks, erased, [&](CapsuleCollider& c) { updateErased(c, dt, bilinear); });
+        double inlinedNs = timeColliders(terrain, ticks, inlined, [&](CapsuleCollider& c) { c.update(dt, bilinear); });
+        report("bilinear", erasedNs, inlinedNs);
+    }
+    if (!ok)
+        std::cout << "  CHECK FAILED\n";
+    return ok;
+}
+
+// The bench terrain as rows, for HeightfieldMinMax
+std::vector<std::vector<float>> benchRows(const HeightGrid& terrain) {
+    std::vector<std::vector<float>> rows(terrain.h, std::vector<float>(terrain.w));
+    for (int z = 0; z < terrain.h; ++z)
+        for (int x = 0; x < terrain.w; ++x)
+            rows[z][x] = terrain.at(x, z);
+    return rows;
+}
+
+// Stands a capsule (radius 0.5, 2 m tall) on flat ground, walks it at 3 m/s
+// into a single rise across one cell and reports whether it got on top
+bool climbsStep(float spacing, float rise, const CapsuleMoveSettings& settings) {
+    const float dt = 1.0f / 60.0f, stepX = 4.0f;
+    HeightGrid terrain;
+    terrain.w = (int)std::lround(8.0f / spacing) + 1;
+    terrain.h = (int)std::lround(4.0f / spacing) + 1;
+    terrain.spacing = spacing;
+    terrain.heights.resize(size_t(terrain.w) * terrain.h);
+    for (int z = 0; z < terrain.h; ++z)
+        for (int x = 0; x < terrain.w; ++x)
+            terrain.heights[z * terrain.w + x] = x * spacing >= stepX ? rise : 0.0f;
+    const HeightfieldMinMax minMax(benchRows(terrain));
+    const TerrainCollider collider(terrain, minMax);
+
+    CapsuleCollider c(2.0f, 1.0f, 2.0f, 2.0f, 0.5f);
+    for (int t = 0; t < 10; ++t)
+        c.move(dt, 0.0f, 0.0f, collider, settings);
+    for (int t = 0; t < 180; ++t)
+        c.move(dt, 3.0f * dt, 0.0f, collider, settings);
+    return c.onGround && c.posX > stepX + 0.5f && c.posY - c.height / 2.0f > rise - 0.01f;
+}
+
+bool benchTerrain() {
+    const HeightGrid terrain = makeBenchTerrain();
+    const HeightfieldMinMax minMax(benchRows(terrain));
+    const TerrainCollider collider(terrain, minMax);
+    const float dt = 1.0f / 60.0f;
+    const int ticks = 256;
+    std::vector<CapsuleCollider> pointSampled(4096, CapsuleCollider(0, 0, 0, 4.0f, 1.0f)), triangles = pointSampled;
+
+    std::cout << "Capsule against terrain, " << triangles.size() << " colliders x " << ticks << " ticks\n";
+    auto bilinear = [&terrain](float x, float z) { return terrain.sample(x, z); };
+    double pointNs = timeColliders(terrain, ticks, pointSampled, [&](CapsuleCollider& c) { c.update(dt, bilinear); });
+    std::cout << "  update, bilinear sample:  " << pointNs << " ns/capsule\n";
+
+    // timeColliders has already moved them horizontally; move() takes the
+    // walk itself, so undo it to cover the same path
+    double triangleNs = timeColliders(terrain, ticks, triangles, [&](CapsuleCollider& c) {
+        c.moveHorizontal(-0.05f, -0.03f);
+        c.move(dt, 0.05f, 0.03f, collider);
+    });
+    size_t grounded = 0;
+    for (const CapsuleCollider& c : triangles)
+        grounded += c.onGround;
+    std::cout << "  move, triangle contacts:  " << triangleNs << " ns/capsule ("
+        << 100.0 * grounded / triangles.size() << "% on the ground at the end)\n";
+
+    // Capsules well clear of the terrain only pay for the min/max reject
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<glm::vec3> airborne(4096);
+    for (glm::vec3& p : airborne) {
+        p.x = unit(rng) * terrain.extentX();
+        p.z = unit(rng) * terrain.extentZ();
+        p.y = terrain.sample(p.x, p.z) + 20.0f + 10.0f * unit(rng);
+    }
+    TerrainContact contact;
+    size_t hits = 0;
+    auto start = Clock::now();
+    for (int t = 0; t < ticks; ++t)
+        for (const glm::vec3& p : airborne)
+            hits += collider.findContact(p, 2.0f, 1.0f, contact);
+    double airborneNs = elapsedNs(start) / (double(ticks) * airborne.size());
+    std::cout << "  findContact, airborne:    " << airborneNs << " ns/capsule" << (hits ? ", UNEXPECTED HITS" : "") << "\n";
+
+    // The same ten seconds of walking at lower tick rates. Longer ticks take
+    // longer moves, which are swept so they don't pass through the terrain.
+    std::cout << "  10 s of walking at 6 m/s:\n";
+    for (int rate : { 60, 20, 10 }) {
+        std::vector<CapsuleCollider> walkers(4096, CapsuleCollider(0, 0, 0, 4.0f, 1.0f));
+        std::vector<glm::vec2> velocities(walkers.size());
+        std::mt19937 walkRng(3);
+        for (size_t i = 0; i < walkers.size(); ++i) {
+            CapsuleCollider& c = walkers[i];
+            c.posX = unit(walkRng) * terrain.extentX();
+            c.posZ = unit(walkRng) * terrain.extentZ();
+            c.posY = terrain.sample(c.posX, c.posZ) + 2.0f;
+            float angle = unit(walkRng) * 6.2831853f;
+            velocities[i] = glm::vec2(std::cos(angle), std::sin(angle)) * 6.0f;
+        }
+        const float tickDt = 1.0f / rate;
+        start = Clock::now();
+        for (int t = 0; t < 10 * rate; ++t)
+            for (size_t i = 0; i < walkers.size(); ++i)
+                walkers[i].move(tickDt, velocities[i].x * tickDt, velocities[i].y * tickDt, collider);
+        double ns = elapsedNs(start) / walkers.size();
+        int below = 0;
+        for (const CapsuleCollider& c : walkers)
+            below += c.posY - c.height / 2.0f < terrain.sample(c.posX, c.posZ) - 0.5f;
+        std::cout << "    " << rate << " Hz: " << ns / 10.0 << " ns per capsule-second"
+            << (below ? ", " + std::to_string(below) + " UNDER THE TERRAIN" : "") << "\n";
+    }
+
+    // Rises just under stepHeight are stepped onto, those just over stop the capsule
+    std::cout << "  Walking into a step at 3 m/s:\n";
+    bool ok = true;
+    for (float spacing : { 0.1f, 0.25f }) {
+        for (float stepHeight : { 0.5f, 1.0f }) {
+            CapsuleMoveSettings settings;
+            settings.stepHeight = stepHeight;
+            bool under = climbsStep(spacing, stepHeight - 0.05f, settings);
+            bool over = climbsStep(spacing, stepHeight + 0.05f, settings);
+            std::cout << "    " << spacing << " m cells, stepHeight " << stepHeight << ": " << stepHeight - 0.05f
+                << " rise " << (under ? "climbed" : "blocked") << ", " << stepHeight + 0.05f << " rise "
+                << (over ? "climbed" : "blocked") << (under && !over ? "" : ", WRONG") << "\n";
+            ok = ok && under && !over;
+        }
+    }
+    if (!ok)
+        std::cout << "  CHECK FAILED\n";
+    return ok;
+}
+
+// Agents standing on the ground in a square of the terrain, the given share
+// of them walking at 3 m/s as main's do and the rest standing still
+void fillCrowd(CapsuleWorld& world, const HeightGrid& terrain, size_t count, float side, float walking = 1.0f) {
+    std::mt19937 rng(21);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    world.clear();
+    world.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        float x = unit(rng) * side, z = unit(rng) * side;
+        float angle = unit(rng) * 6.2831853f;
+        float speed = unit(rng) < walking ? 3.0f : 0.0f;
+        world.add(glm::vec3(x, terrain.sample(x, z) + 2.0f, z), 4.0f, 1.0f,
+            glm::vec3(std::cos(angle), 0.0f, std::sin(angle)) * speed);
+    }
+}
+
+bool benchCrowd() {
+    const HeightGrid terrain = makeBenchTerrain();
+    const float dt = 1.0f / 60.0f;
+    const size_t count = 10000;
+    const int ticks = 600;
+    std::cout << "Crowd: " << count << " agents colliding with each other, " << ticks << " ticks at 60 Hz on a "
+        << terrain.extentX() << " m square\n";
+
+    bool ok = true;
+    for (float side : { terrain.extentX(), 400.0f }) {
+        for (float cellSize : { terrain.spacing, terrain.spacing / 4.0f }) {
+            CapsuleWorld world, reference;
+            fillCrowd(world, terrain, count, side);
+            fillCrowd(reference, terrain, count, side);
+            CapsuleBroadphase grid;
+            grid.init(terrain.extentX(), terrain.extentZ(), cellSize);
+            std::vector<CapsulePair> pairs;
+            pairs.reserve(count * 8);
+
+            double stepNs = 0.0, updateNs = 0.0, pairsNs = 0.0, collideNs = 0.0, scalarNs = 0.0;
+            size_t pairTotal = 0, contactTotal = 0, relinkTotal = 0;
+            bool same = true;
+            for (int t = 0; t < ticks; ++t) {
+                auto start = Clock::now();
+                world.step(dt, terrain);
+                stepNs += elapsedNs(start);
+                start = Clock::now();
+                grid.update(world);
+                updateNs += elapsedNs(start);
+                start = Clock::now();
+                grid.findPairs(world, pairs);
+                pairsNs += elapsedNs(start);
+                start = Clock::now();
+                contactTotal += world.collide(pairs);
+                collideNs += elapsedNs(start);
+
+                // The reference world takes the same pairs through the scalar path
+                reference.step(dt, terrain);
+                start = Clock::now();
+                reference.collideScalar(pairs);
+                scalarNs += elapsedNs(start);
+                same = same && sameState(world, reference);
+
+                pairTotal += pairs.size();
+                relinkTotal += grid.relinked;
+            }
+            double us = 1e-3 / ticks;
+            std::cout << "  spread over " << side << " m, " << cellSize << " m cells: "
+                << (stepNs + updateNs + pairsNs + collideNs) * us << " us/tick (" << stepNs * us << " step, "
+                << updateNs * us << " grid update, " << pairsNs * us << " pairs, " << collideNs * us
+                << " collide; scalar collide " << scalarNs * us << ")\n"
+                << "    " << pairTotal / ticks << " pairs, " << contactTotal / ticks << " contacts, "
+                << relinkTotal / ticks << " relinked per tick" << (same ? "" : ", RESULTS DIFFER") << "\n";
+            ok = ok && same;
+        }
+    }
+    if (!ok)
+        std::cout << "  CHECK FAILED\n";
+    return ok;
+}
+
+bool benchSleep() {
+    const HeightGrid terrain = makeBenchTerrain();
+    const float dt = 1.0f / 60.0f;
+    const size_t count = 10000;
+    const int ticks = 600;
+    const float cellSize = terrain.spacing / 4.0f;
+    std::cout << "Sleeping: " << count << " agents, " << ticks << " ticks at 60 Hz on a " << terrain.extentX()
+        << " m square, " << cellSize << " m cells\n";
+
+    bool ok = true;
+    for (float walking : { 0.1f, 0.5f }) {
+        for (bool sleeping : { false, true }) {
+            // The reference runs the scalar paths through its own grid
+            CapsuleWorld world, reference;
+            CapsuleBroadphase grid, referenceGrid;
+            for (CapsuleWorld* w : { &world, &reference }) {
+                fillCrowd(*w, terrain, count, terrain.extentX(), walking);
+                if (!sleeping)
+                    w->sleepSpeed = 0.0f;
+            }
+            grid.init(terrain.extentX(), terrain.extentZ(), cellSize);
+            referenceGrid.init(terrain.extentX(), terrain.extentZ(), cellSize);
+            std::vector<CapsulePair> pairs, referencePairs;
+            pairs.reserve(count * 8);
+            referencePairs.reserve(count * 8);
+
+            double stepNs = 0.0, updateNs = 0.0, pairsNs = 0.0, collideNs = 0.0;
+            size_t awakeTotal = 0;
+            bool same = true;
+            for (int t = 0; t < ticks; ++t) {
+                auto start = Clock::now();
+                world.step(dt, terrain);
+                stepNs += elapsedNs(start);
+                start = Clock::now();
+                grid.update(world);
+                updateNs += elapsedNs(start);
+                start = Clock::now();
+                grid.findPairs(world, pairs);
+                pairsNs += elapsedNs(start);
+                start = Clock::now();
+                world.collide(pairs);
+                collideNs += elapsedNs(start);
+                awakeTotal += world.awakeCount();
+
+                reference.stepScalar(dt, terrain);
+                referenceGrid.update(reference);
+                referenceGrid.findPairs(reference, referencePairs);
+                reference.collideScalar(referencePairs);
+                same = same && world.awakeCount() == reference.awakeCount() && sameState(world, reference);
+            }
+            double us = 1e-3 / ticks;
+            std::cout << "  " << walking * 100.0f << "% walking, " << (sleeping ? "sleeping" : "always awake")
+                << ": " << (stepNs + updateNs + pairsNs + collideNs) * us << " us/tick (" << stepNs * us
+                << " step, " << updateNs * us << " grid update, " << pairsNs * us << " pairs, " << collideNs * us
+                << " collide)\n    " << awakeTotal / ticks << " awake on average, " << world.awakeCount()
+                << " at the end" << (same ? "" : ", RESULTS DIFFER") << "\n";
+            ok = ok && same;
+        }
+    }
+    if (!ok)
+        std::cout << "  CHECK FAILED\n";
+    return ok;
+}
+
+// Times GeometryClipmap::update along a camera path: settling, walking,
+// running faster than the upload budget keeps up with, then standing still.
+// --self-test clipmap checks what it uploads.
+void benchClipmap() {
+    const int levelCount = 5, ringSize = 64;
+    const size_t budget = 16 * 1024;
+    GeometryClipmap clipmap([](int x, int z) { return std::sin(x * 0.013f) * 40.0f + std::cos(z * 0.021f) * 25.0f; },
+        1.0f, levelCount, ringSize, budget);
+    std::cout << "Clipmap: " << levelCount << " levels of " << ringSize << "^2, " << budget / 1024
+        << " KB upload budget\n";
+
+    struct Leg { const char* name; int frames; float dx, dz; };
+    const Leg path[] = {
+        { "settling", 60, 0.0f, 0.0f }, { "walking", 400, 0.7f, 0.3f }, { "running", 40, 37.0f, -23.0f },
+        { "standing", 300, 0.0f, 0.0f },
+    };
+    glm::vec3 camera(1000.0f, 0.0f, 1000.0f);
+    for (const Leg& leg : path) {
+        size_t bytes = 0;
+        auto start = Clock::now();
+        for (int f = 0; f < leg.frames; ++f) {
+            camera.x += leg.dx;
+            camera.z += leg.dz;
+            clipmap.update(camera);
+            bytes += clipmap.lastUploadBytes;
+        }
+        std::cout << "  " << leg.name << ": " << elapsedNs(start) * 1e-3 / leg.frames << " us per update, "
+            << bytes / leg.frames << " B uploaded per frame\n";
+    }
+    std::cout << "  peak " << clipmap.peakUploadBytes << " B in one frame\n";
+}
+
+// Two-sided Moller-Trumbore, for the brute-force reference below
+bool rayTriangle(const glm::vec3& o, const glm::vec3& d, const glm::vec3& v0, const glm::vec3& v1,
+    const glm::vec3& v2, float& t) {
+    glm::vec3 e1 = v1 - v0, e2 = v2 - v0;
+    glm::vec3 p = glm::cross(d, e2);
+    float det = glm::dot(e1, p);
+    if (std::abs(det) < 1e-12f)
+        return false;
+    float inv = 1.0f / det;
+    glm::vec3 s = o - v0;
+    float u = glm::dot(s, p) * inv;
+    if (u < 0.0f || u > 1.0f)
+        return false;
+    glm::vec3 q = glm::cross(s, e1);
+    float v = glm::dot(d, q) * inv;
+    if (v < 0.0f || u + v > 1.0f)
+        return false;
+    t = glm::dot(e2, q) * inv;
+    return true;
+}
+
+// The nearest hit found by testing every triangle of the grid, with no
+// pyramid to get wrong. Distance along the normalized direction.
+bool raycastBruteForce(const HeightGrid& grid, const TerrainRay& ray, float& distance) {
+    const glm::vec3 dir = glm::normalize(ray.direction);
+    const float s = grid.spacing;
+    bool found = false;
+    distance = ray.maxDistance;
+    for (int z = 0; z + 1 < grid.h; ++z) {
+        for (int x = 0; x + 1 < grid.w; ++x) {
+            glm::vec3 p00(x * s, grid.at(x, z), z * s);
+            glm::vec3 p10((x + 1) * s, grid.at(x + 1, z), z * s);
+            glm::vec3 p01(x * s, grid.at(x, z + 1), (z + 1) * s);
+            glm::vec3 p11((x + 1) * s, grid.at(x + 1, z + 1), (z + 1) * s);
+            float t;
+            if (rayTriangle(ray.origin, dir, p00, p01, p10, t) && t >= 0.0f && t <= distance) {
+                distance = t;
+                found = true;
+            }
+            if (rayTriangle(ray.origin, dir, p10, p01, p11, t) && t >= 0.0f && t <= distance) {
+                distance = t;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+// TerrainRaycaster against raycastBruteForce on a small, rough grid, with
+// rays from above, below, level, outside the grid and cut short. Returns the
+// number of rays whose hit or distance differ.
+size_t checkRaycastBruteForce() {
+    const int n = 65;
+    std::vector<std::vector<float>> rows(n, std::vector<float>(n));
+    for (int z = 0; z < n; ++z)
+        for (int x = 0; x < n; ++x)
+            rows[z][x] = 30.0f * std::sin(x * 0.2f) * std::cos(z * 0.15f) + 5.0f * std::sin(x * 0.9f + z * 0.7f)
+                + ((x * 7 + z * 3) % 11 == 0 ? 25.0f : 0.0f);
+    const HeightGrid grid(rows, 10.0f);
+    const HeightfieldMinMax minMax(rows);
+    const TerrainRaycaster raycaster(grid, minMax);
+    const float extent = grid.extentX();
+
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    size_t mismatched = 0;
+    for (int i = 0; i < 20000; ++i) {
+        TerrainRay ray;
+        float angle = unit(rng) * 6.2831853f;
+        ray.origin = glm::vec3(unit(rng) * extent, 0.0f, unit(rng) * extent);
+        switch (i % 6) {
+        case 0:
+            ray.origin.y = 100.0f;
+            ray.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+            break;
+        case 1:
+            ray.origin.y = 40.0f + 40.0f * unit(rng);
+            ray.direction = glm::vec3(std::cos(angle), -0.05f - 0.3f * unit(rng), std::sin(angle));
+            break;
+        case 2:
+            ray.origin.y = -60.0f;
+            ray.direction = glm::vec3(unit(rng) - 0.5f, 0.3f, unit(rng) - 0.5f);
+            break;
+        case 3:
+            ray.origin.y = 60.0f * unit(rng) - 30.0f;
+            ray.direction = glm::vec3(std::cos(angle), 0.0f, std::sin(angle));
+            break;
+        case 4:
+            ray.origin = glm::vec3(-100.0f + (extent + 200.0f) * unit(rng), 50.0f, -100.0f + (extent + 200.0f) * unit(rng));
+            ray.direction = glm::vec3(unit(rng) - 0.5f, -0.2f * unit(rng), unit(rng) - 0.5f);
+            break;
+        default:
+            ray.origin.y = 50.0f;
+            ray.direction = glm::vec3(3.0f * std::cos(angle), -1.0f, 3.0f * std::sin(angle));
+            ray.maxDistance = 200.0f * unit(rng);
+            break;
+        }
+        TerrainRayHit hit;
+        bool got = raycaster.raycast(ray, hit);
+        float distance;
+        bool expected = raycastBruteForce(grid, ray, distance);
+        mismatched += got != expected || (got && std::abs(hit.distance - distance) > 1e-3f * std::max(1.0f, distance));
+    }
+    return mismatched;
+}
+
+bool benchRaycast() {
+    const HeightGrid terrain = makeBenchTerrain();
+    const HeightfieldMinMax minMax(benchRows(terrain));
+    const TerrainRaycaster raycaster(terrain, minMax);
+    const size_t count = 1 << 18;
+    std::cout << "Terrain raycasts, " << count << " rays per set, " << JobSystem::instance().workerCount()
+        << " workers for the batches\n";
+
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    auto onTerrain = [&](float above) {
+        float x = unit(rng) * terrain.extentX(), z = unit(rng) * terrain.extentZ();
+        return glm::vec3(x, terrain.sample(x, z) + above, z);
+    };
+
+    std::vector<TerrainRay> rays(count);
+    std::vector<TerrainRayHit> single(count), batched(count);
+    bool ok = true;
+    for (const char* set : { "picking", "line of sight", "straight down" }) {
+        for (TerrainRay& ray : rays) {
+            if (set[0] == 'p') {
+                // A camera a little above the ground looking near the horizon
+                float angle = unit(rng) * 6.2831853f;
+                ray.origin = onTerrain(5.0f + 50.0f * unit(rng));
+                ray.direction = glm::vec3(std::cos(angle), -0.02f - 0.2f * unit(rng), std::sin(angle));
+                ray.maxDistance = 5000.0f;
+            }
+            else if (set[0] == 'l') {
+                // Between two agents' eyes
+                glm::vec3 from = onTerrain(2.0f), to = onTerrain(2.0f);
+                ray.origin = from;
+                ray.direction = to - from;
+                ray.maxDistance = glm::length(to - from);
+            }
+            else {
+                ray.origin = onTerrain(100.0f);
+                ray.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+                ray.maxDistance = 1000.0f;
+            }
+        }
+
+        auto start = Clock::now();
+        for (size_t i = 0; i < count; ++i)
+            raycaster.raycast(rays[i], single[i]);
+        double singleNs = elapsedNs(start);
+        start = Clock::now();
+        raycaster.raycast(rays.data(), batched.data(), count);
+        double batchedNs = elapsedNs(start);
+
+        size_t hits = 0;
+        bool same = true;
+        for (size_t i = 0; i < count; ++i) {
+            hits += single[i].hit;
+            same = same && single[i].hit == batched[i].hit && single[i].distance == batched[i].distance;
+        }
+        std::cout << "  " << set << ": " << count * 1e3 / singleNs << " Mrays/s one thread, "
+            << count * 1e3 / batchedNs << " Mrays/s batched, " << 100.0 * hits / count << "% hit"
+            << (same ? "" : ", RESULTS DIFFER") << "\n";
+        ok = ok && same;
+    }
+
+    size_t mismatched = checkRaycastBruteForce();
+    std::cout << "  against every cell of a 65x65 grid: " << mismatched << " of 20000 rays differ\n";
+    ok = ok && mismatched == 0;
+    if (!ok)
+        std::cout << "  CHECK FAILED\n";
+    return ok;
+}
+
+}
+
+bool runBenchmark(const std::string& name) {
+    if (name == "jobs") {
+        benchJobs();
+        return true;
+    }
+    if (name == "capsules")
+        return benchCapsules();
+    if (name == "collider")
+        return benchCollider();
+    if (name == "terrain")
+        return benchTerrain();
+    if (name == "raycast")
+        return benchRaycast();
+    if (name == "crowd")
+        return benchCrowd();
+    if (name == "sleep")
+        return benchSleep();
+    if (name == "clipmap") {
+        benchClipmap();
+        return true;
+    }
+    std::cerr << "Unknown benchmark " << name << " (jobs, capsules, collider, terrain, raycast, crowd, sleep, clipmap)\n";
+    return false;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+
+// Microbenchmarks, run from the command line with --bench NAME instead of
+// opening the renderer. Returns false for an unknown name or a failed check.
+//   jobs: per-job overhead of the job system
+//   capsules: CapsuleWorld steps, scalar against batched, in capsules/ms
+//   collider: CapsuleCollider::update through std::function against inlined
+//   terrain: CapsuleCollider::move's triangle contacts against update's point
+//            sample, move's cost at lower tick rates, and a check that it
+//            climbs steps under stepHeight and stops at higher ones
+//   raycast: TerrainRaycaster rays/s, one at a time and batched, and its hits
+//            checked against every cell of a small grid
+//   crowd: 10k agents stepped, broadphased and collided with each other, per tick
+//   sleep: the crowd, mostly standing, with and without sleeping
+//   clipmap: GeometryClipmap updates along a camera path, and bytes uploaded
+bool runBenchmark(const std::string& name);
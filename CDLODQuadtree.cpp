@@ -0,0 +1,128 @@
+#include "CDLODQuadtree.h"
+#include <algorithm>
+#include <cmath>
+
+static bool sphereIntersectsAABB(const glm::vec3& c, float r, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+    glm::vec3 closest = glm::clamp(c, boxMin, boxMax);
+    glm::vec3 d = c - closest;
+    return glm::dot(d, d) <= r * r;
+}
+
+CDLODQuadtree::CDLODQuadtree(const std::vector<std::vector<float>>& heightMap, float spacing, int patchSize)
+    : patchSize(patchSize), lodCount(1), spacing(spacing), minMax(heightMap) {
+    cellsW = minMax.cellsW;
+    cellsH = minMax.cellsH;
+
+    // Enough levels for a single root node to cover the heightmap
+    int extent = std::max(cellsW, cellsH);
+    while ((patchSize << (lodCount - 1)) < extent)
+        ++lodCount;
+
+    computeLevelErrors(heightMap);
+}
+
+void CDLODQuadtree::computeLevelErrors(const std::vector<std::vector<float>>& heightMap) {
+    levelError.assign(lodCount, 0.0f);
+    const int w = cellsW + 1, h = cellsH + 1;
+
+    for (int lod = 1; lod < lodCount; ++lod) {
+        const int step = 1 << lod;
+        float err = 0.0f;
+        for (int z = 0; z < h; ++z) {
+            int z0 = (z / step) * step;
+            int z1 = std::min(z0 + step, h - 1);
+            float tz = z1 > z0 ? float(z - z0) / float(z1 - z0) : 0.0f;
+            for (int x = 0; x < w; ++x) {
+                int x0 = (x / step) * step;
+                int x1 = std::min(x0 + step, w - 1);
+                float tx = x1 > x0 ? float(x - x0) / float(x1 - x0) : 0.0f;
+                float hx0 = glm::mix(heightMap[z0][x0], heightMap[z0][x1], tx);
+                float hx1 = glm::mix(heightMap[z1][x0], heightMap[z1][x1], tx);
+                err = std::max(err, std::abs(heightMap[z][x] - glm::mix(hx0, hx1, tz)));
+            }
+        }
+        // A coarser level can never be more accurate than a finer one
+        levelError[lod] = std::max(err, levelError[lod - 1]);
+    }
+}
+
+void CDLODQuadtree::computeLodRanges(float pixelError, float viewportHeight, float fovY, float visibilityDistance) {
+    // Distance at which one world unit of vertical error covers one pixel
+    const float pixelsPerUnit = viewportHeight / (2.0f * std::tan(fovY * 0.5f));
+
+    lodRanges.assign(lodCount, 0.0f);
+    morphStart.assign(lodCount, 0.0f);
+    float prev = 0.0f;
+    for (int lod = 0; lod < lodCount; ++lod) {
+        float nodeSize = float(patchSize << lod) * spacing;
+        float range;
+        if (lod + 1 < lodCount)
+            range = levelError[lod + 1] * pixelsPerUnit / pixelError;
+        else
+            range = visibilityDistance;
+
+        // Keep neighbouring nodes within one LOD of each other: every level's
+        // band must be wider than its own node size, and ranges must double.
+        range = std::max(range, prev * 2.0f);
+        range = std::max(range, prev + nodeSize * 1.5f);
+        lodRanges[lod] = range;
+        morphStart[lod] = prev + (range - prev) * 0.66f;
+        prev = range;
+    }
+}
+
+bool CDLODQuadtree::nodeBounds(int x, int z, int size, glm::vec3& boxMin, glm::vec3& boxMax) const {
+    float minH, maxH;
+    if (!minMax.rangeMinMax(x, z, x + size, z + size, minH, maxH))
+        return false;
+    boxMin = glm::vec3(x * spacing, minH, z * spacing);
+    boxMax = glm::vec3(std::min(x + size, cellsW) * spacing, maxH, std::min(z + size, cellsH) * spacing);
+    return true;
+}
+
+void CDLODQuadtree::select(const glm::vec3& cameraPos, const Frustum& frustum, CDLODSelection& out) const {
+    out.fullNodes.clear();
+    out.quarterNodes.clear();
+
+    const int rootSize = patchSize << (lodCount - 1);
+    for (int z = 0; z < cellsH; z += rootSize)
+        for (int x = 0; x < cellsW; x += rootSize)
+            selectNode(x, z, lodCount - 1, cameraPos, frustum, out);
+}
+
+// Returns false if the node is outside its own LOD range, in which case the
+// parent covers the area with its coarser level instead.
+bool CDLODQuadtree::selectNode(int x, int z, int lod, const glm::vec3& cameraPos, const Frustum& frustum, CDLODSelection& out) const {
+    const int size = patchSize << lod;
+    glm::vec3 boxMin, boxMax;
+    if (!nodeBounds(x, z, size, boxMin, boxMax))
+        return true; // entirely off the heightmap, nothing to draw
+
+    if (!sphereIntersectsAABB(cameraPos, lodRanges[lod], boxMin, boxMax))
+        return false;
+
+    if (!frustum.intersectsAABB(boxMin, boxMax))
+        return true; // handled: culled
+
+    const float scale = float(1 << lod);
+    if (lod == 0 || !sphereIntersectsAABB(cameraPos, lodRanges[lod - 1], boxMin, boxMax)) {
+        out.fullNodes.push_back({ float(x), float(z), scale, float(lod) });
+        return true;
+    }
+
+    const int half = size / 2;
+    for (int i = 0; i < 4; ++i) {
+        int cx = x + (i & 1) * half;
+        int cz = z + (i >> 1) * half;
+        if (cx >= cellsW || cz >= cellsH)
+            continue;
+        if (!selectNode(cx, cz, lod - 1, cameraPos, frustum, out))
+            out.quarterNodes.push_back({ float(cx), float(cz), scale, float(lod) });
+    }
+    return true;
+}
+
+size_t CDLODQuadtree::triangleCount(const CDLODSelection& selection) const {
+    size_t perPatch = size_t(patchSize) * patchSize * 2;
+    return selection.fullNodes.size() * perPatch + selection.quarterNodes.size() * perPatch / 4;
+}
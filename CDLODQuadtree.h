@@ -0,0 +1,55 @@
+#pragma once
+#include "HeightfieldMinMax.h"
+#include "Frustum.h"
+#include <glm.hpp>
+#include <vector>
+
+// Per-instance data for one selected CDLOD node. Layout matches the vec4
+// instance attribute consumed by cdlodVertSrc.
+struct CDLODInstance {
+    float cellX, cellZ; // node origin in heightmap cells
+    float scale;        // cells per patch vertex (1 << lod)
+    float lod;
+};
+
+// Nodes chosen for one camera. Kept apart from the tree so a selection can
+// be made on one thread and drawn on another.
+struct CDLODSelection {
+    std::vector<CDLODInstance> fullNodes;
+    std::vector<CDLODInstance> quarterNodes;
+};
+
+// CPU side of Continuous Distance-Dependent LOD (Strugar 2009). A quadtree
+// over the heightmap is walked every frame; each selected node is drawn with
+// the same patchSize x patchSize grid, scaled by 2^lod. LOD ranges come from
+// a screen-space error target: level k is only used where its worst-case
+// vertical error projects to fewer than pixelError pixels.
+class CDLODQuadtree {
+public:
+    int patchSize;      // cells per patch edge, multiple of 4
+    int lodCount;
+    float spacing;
+    int cellsW, cellsH;
+
+    std::vector<float> levelError;  // worst vertical error of each LOD, world units
+    std::vector<float> lodRanges;   // max view distance of each LOD
+    std::vector<float> morphStart;  // distance at which each LOD starts morphing
+
+    CDLODQuadtree(const std::vector<std::vector<float>>& heightMap, float spacing, int patchSize = 16);
+
+    // Derive lodRanges/morphStart from a pixel error budget. fovY in radians.
+    void computeLodRanges(float pixelError, float viewportHeight, float fovY, float visibilityDistance);
+
+    // Read-only on the tree, so it's safe off the GL thread
+    void select(const glm::vec3& cameraPos, const Frustum& frustum, CDLODSelection& out) const;
+
+    // Triangles submitted for a selection
+    size_t triangleCount(const CDLODSelection& selection) const;
+
+private:
+    HeightfieldMinMax minMax;
+
+    void computeLevelErrors(const std::vector<std::vector<float>>& heightMap);
+    bool selectNode(int x, int z, int lod, const glm::vec3& cameraPos, const Frustum& frustum, CDLODSelection& out) const;
+    bool nodeBounds(int x, int z, int size, glm::vec3& boxMin, glm::vec3& boxMax) const;
+};
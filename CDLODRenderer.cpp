@@ -0,0 +1,162 @@
+﻿#include "CDLODRenderer.h"
+#include "HeightTexture.h"
+#include <algorithm>
+#include <cstring>
+
+const char* cdlodVertSrc = R"(
+#version 330 core
+layout(location = 0) in vec2 gridPos;   // patch vertex, 0..patchSize
+layout(location = 1) in vec4 node;      // cellX, cellZ, scale, lod
+out float vHeight;
+layout(std140) uniform Frame {
+    mat4 mvp;
+    vec4 cameraPos;
+};
+layout(std140) uniform CDLODDraw {
+    vec4 grid;                          // last cell index x/z, spacing
+    vec4 morphConsts[16];               // per LOD: morph start, 1 / morph length
+};
+uniform sampler2D heightTex;
+
+float sampleHeight(vec2 cell) {
+    return texture(heightTex, (cell + 0.5) / vec2(textureSize(heightTex, 0))).r;
+}
+
+void main() {
+    vec2 cell = min(node.xy + gridPos * node.z, grid.xy);
+    vec3 world = vec3(cell.x * grid.z, sampleHeight(cell), cell.y * grid.z);
+
+    vec2 mc = morphConsts[int(node.w)].xy;
+    float morph = clamp((distance(cameraPos.xyz, world) - mc.x) * mc.y, 0.0, 1.0);
+
+    // Slide odd vertices onto their even neighbour so the patch turns into
+    // the next coarser level by the end of the range
+    vec2 odd = fract(gridPos * 0.5) * 2.0;
+    cell = min(node.xy + (gridPos - odd * morph) * node.z, grid.xy);
+    world = vec3(cell.x * grid.z, sampleHeight(cell), cell.y * grid.z);
+
+    gl_Position = mvp * vec4(world, 1.0);
+    vHeight = world.y;
+})";
+
+void CDLODRenderer::init(const CDLODQuadtree& tree, const std::vector<std::vector<float>>& heightMap, GLuint prog) {
+    program = prog;
+    bindUniformBlock(program, "Frame", FRAME_UNIFORM_BINDING);
+    bindUniformBlock(program, "CDLODDraw", DRAW_UNIFORM_BINDING);
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "heightTex"), 0);
+
+    heightTex = createHeightTexture(heightMap);
+
+    // Shared (N+1)x(N+1) patch. Full-patch indices come first, followed by
+    // the indices of the first quadrant for partially covered nodes.
+    const int n = tree.patchSize;
+    std::vector<float> grid;
+    for (int y = 0; y <= n; ++y) {
+        for (int x = 0; x <= n; ++x) {
+            grid.push_back((float)x);
+            grid.push_back((float)y);
+        }
+    }
+
+    std::vector<unsigned int> indices;
+    auto emitQuads = [&](int cells) {
+        for (int y = 0; y < cells; ++y) {
+            for (int x = 0; x < cells; ++x) {
+                unsigned int v0 = y * (n + 1) + x;
+                unsigned int v1 = v0 + 1;
+                unsigned int v2 = v0 + (n + 1);
+                unsigned int v3 = v2 + 1;
+                indices.insert(indices.end(), { v0, v2, v1, v1, v2, v3 });
+            }
+        }
+    };
+    emitQuads(n);
+    fullIndexCount = (GLsizei)indices.size();
+    emitQuads(n / 2);
+    quarterIndexCount = (GLsizei)indices.size() - fullIndexCount;
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &patchVbo);
+    glGenBuffers(1, &patchEbo);
+    glGenBuffers(1, &instanceVbo);
+
+    glBindVertexArray(vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, patchVbo);
+    glBufferData(GL_ARRAY_BUFFER, grid.size() * sizeof(float), grid.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(CDLODInstance), (void*)0);
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(1);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, patchEbo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+}
+
+void CDLODRenderer::draw(const CDLODQuadtree& tree, const CDLODSelection& selection, StreamBuffer& stream, GLStateCache& state) {
+    const size_t fullCount = selection.fullNodes.size();
+    const size_t quarterCount = selection.quarterNodes.size();
+    const size_t total = fullCount + quarterCount;
+    if (total == 0)
+        return;
+
+    state.bindVertexArray(vao);
+
+    // Instances go through the streaming ring; the private buffer is only
+    // used if the ring can't fit this frame's selection
+    size_t instanceBase = 0;
+    void* dst = stream.map(total * sizeof(CDLODInstance), sizeof(CDLODInstance), instanceBase);
+    if (dst) {
+        std::memcpy(dst, selection.fullNodes.data(), fullCount * sizeof(CDLODInstance));
+        std::memcpy((char*)dst + fullCount * sizeof(CDLODInstance), selection.quarterNodes.data(), quarterCount * sizeof(CDLODInstance));
+        stream.unmap();
+        glBindBuffer(GL_ARRAY_BUFFER, stream.buffer);
+    }
+    else {
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+        if (total > instanceCapacity) {
+            instanceCapacity = std::max(total, instanceCapacity * 2);
+            glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(CDLODInstance), nullptr, GL_STREAM_DRAW);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, 0, fullCount * sizeof(CDLODInstance), selection.fullNodes.data());
+        glBufferSubData(GL_ARRAY_BUFFER, fullCount * sizeof(CDLODInstance), quarterCount * sizeof(CDLODInstance), selection.quarterNodes.data());
+    }
+
+    CDLODUniforms block = {};
+    block.grid = glm::vec4((float)tree.cellsW, (float)tree.cellsH, tree.spacing, 0.0f);
+    for (int lod = 0; lod < tree.lodCount && lod < MAX_LODS; ++lod) {
+        float start = tree.morphStart[lod];
+        float end = tree.lodRanges[lod];
+        block.morphConsts[lod] = glm::vec4(start, 1.0f / std::max(end - start, 1e-3f), 0.0f, 0.0f);
+    }
+    pushUniformBlock(stream, DRAW_UNIFORM_BINDING, block);
+
+    state.useProgram(program);
+    state.bindTexture(0, GL_TEXTURE_2D, heightTex);
+
+    if (fullCount > 0) {
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(CDLODInstance), (void*)instanceBase);
+        glDrawElementsInstanced(GL_TRIANGLES, fullIndexCount, GL_UNSIGNED_INT, (void*)0, (GLsizei)fullCount);
+    }
+    if (quarterCount > 0) {
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(CDLODInstance), (void*)(instanceBase + fullCount * sizeof(CDLODInstance)));
+        glDrawElementsInstanced(GL_TRIANGLES, quarterIndexCount, GL_UNSIGNED_INT,
+            (void*)(fullIndexCount * sizeof(unsigned int)), (GLsizei)quarterCount);
+    }
+}
+
+void CDLODRenderer::destroy() {
+    glDeleteTextures(1, &heightTex);
+    glDeleteBuffers(1, &instanceVbo);
+    glDeleteBuffers(1, &patchEbo);
+    glDeleteBuffers(1, &patchVbo);
+    glDeleteVertexArrays(1, &vao);
+    vao = patchVbo = patchEbo = instanceVbo = heightTex = 0;
+    instanceCapacity = 0;
+}
@@ -0,0 +1,29 @@
+﻿#pragma once
+#include "CDLODQuadtree.h"
+#include "StreamBuffer.h"
+#include "GLStateCache.h"
+#include "UniformBlocks.h"
+#include <glad/gl.h>
+#include <glm.hpp>
+#include <vector>
+
+extern const char* cdlodVertSrc;
+
+// Draws a CDLODQuadtree selection: one shared grid patch, instanced once per
+// selected node, with heights fetched from a texture and odd vertices
+// morphed towards the next coarser level as they approach their LOD range.
+class CDLODRenderer {
+public:
+    static const int MAX_LODS = CDLODUniforms::MAX_LODS;
+
+    GLuint program = 0;
+    GLuint vao = 0, patchVbo = 0, patchEbo = 0, instanceVbo = 0, heightTex = 0;
+    GLsizei fullIndexCount = 0, quarterIndexCount = 0;
+    size_t instanceCapacity = 0;
+
+    // prog must be linked from cdlodVertSrc. The Frame block must already be
+    // bound; draw() pushes its own CDLODDraw block.
+    void init(const CDLODQuadtree& tree, const std::vector<std::vector<float>>& heightMap, GLuint prog);
+    void draw(const CDLODQuadtree& tree, const CDLODSelection& selection, StreamBuffer& stream, GLStateCache& state);
+    void destroy();
+};
@@ -0,0 +1,142 @@
+#include "CapsuleBroadphase.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+
+void CapsuleBroadphase::init(float extentX, float extentZ, float size) {
+    cellSize = size;
+    cellsX = std::max(1, (int)std::ceil(extentX / size));
+    cellsZ = std::max(1, (int)std::ceil(extentZ / size));
+    // Each cell's awake capsules, then its sleepers
+    head.assign(size_t(cellsX) * cellsZ * 2, -1);
+    next.clear();
+    prev.clear();
+    cell.clear();
+    tracked = 0;
+    relinked = 0;
+}
+
+int CapsuleBroadphase::cellOf(float x, float z) const {
+    int cx = std::clamp((int)(x / cellSize), 0, cellsX - 1);
+    int cz = std::clamp((int)(z / cellSize), 0, cellsZ - 1);
+    return cz * cellsX + cx;
+}
+
+void CapsuleBroadphase::link(int32_t i, int32_t c) {
+    next[i] = head[c];
+    prev[i] = -1;
+    if (head[c] >= 0)
+        prev[head[c]] = i;
+    head[c] = i;
+    cell[i] = c;
+}
+
+void CapsuleBroadphase::unlink(int32_t i) {
+    if (prev[i] >= 0)
+        next[prev[i]] = next[i];
+    else
+        head[cell[i]] = next[i];
+    if (next[i] >= 0)
+        prev[next[i]] = prev[i];
+}
+
+void CapsuleBroadphase::update(const CapsuleWorld& world) {
+    size_t count = world.size();
+    if (count < tracked) {
+        std::fill(head.begin(), head.end(), -1);
+        tracked = 0;
+    }
+
+    relinked = 0;
+    auto list = [&](size_t i) {
+        return cellOf(world.posX[i], world.posZ[i]) * 2 + (world.isAsleep(i) ? 1 : 0);
+    };
+    auto refresh = [&](size_t i) {
+        int c = list(i);
+        if (c != cell[i]) {
+            unlink((int32_t)i);
+            link((int32_t)i, c);
+            ++relinked;
+        }
+    };
+    // Sleepers don't move; the only ones to look at are those swapped into
+    // the sleeping range by the last step
+    size_t awake = std::min(world.awakeCount(), tracked);
+    for (size_t i = 0; i < awake; ++i)
+        refresh(i);
+    for (uint32_t i : world.movedSlots) {
+        if (i >= awake && i < tracked)
+            refresh(i);
+    }
+
+    if (count > tracked) {
+        next.resize(count);
+        prev.resize(count);
+        cell.resize(count);
+        for (size_t i = tracked; i < count; ++i)
+            link((int32_t)i, list(i));
+        relinked += count - tracked;
+        tracked = count;
+    }
+}
+
+void CapsuleBroadphase::findPairs(const CapsuleWorld& world, std::vector<CapsulePair>& pairs) const {
+    pairs.clear();
+    const size_t end = std::min(world.awakeCount(), tracked);
+    const size_t ranges = (end + PAIR_GRAIN - 1) / PAIR_GRAIN;
+    if (ranges <= 1) {
+        findPairsFrom(world, 0, end, pairs);
+        return;
+    }
+    if (rangePairs.size() < ranges)
+        rangePairs.resize(ranges);
+    JobSystem::instance().parallelFor(0, ranges, 1, [&](size_t first, size_t last) {
+        for (size_t k = first; k < last; ++k) {
+            rangePairs[k].clear();
+            findPairsFrom(world, k * PAIR_GRAIN, std::min(end, (k + 1) * PAIR_GRAIN), rangePairs[k]);
+        }
+    });
+    for (size_t k = 0; k < ranges; ++k)
+        pairs.insert(pairs.end(), rangePairs[k].begin(), rangePairs[k].end());
+}
+
+// Appends the pairs found from awake capsules [begin, end)
+void CapsuleBroadphase::findPairsFrom(const CapsuleWorld& world, size_t begin, size_t end,
+    std::vector<CapsulePair>& pairs) const {
+    const float* px = world.posX.data();
+    const float* pz = world.posZ.data();
+    const float* r = world.radius.data();
+
+    // From each awake capsule: the rest of its own cell and the forward half
+    // of its neighbours, so each pair of cells is visited from one side
+    // only, then all of the neighbouring sleepers, which aren't visited
+    static const int FORWARD[4][2] = { { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } };
+    const bool anyAsleep = world.awakeCount() < tracked;
+    for (size_t a = begin; a < end; ++a) {
+        float ax = px[a], az = pz[a], ar = r[a];
+        auto test = [&](int32_t b) {
+            float reach = ar + r[b];
+            if (std::abs(ax - px[b]) < reach && std::abs(az - pz[b]) < reach)
+                pairs.push_back({ (uint32_t)a, (uint32_t)b });
+        };
+
+        for (int32_t b = next[a]; b >= 0; b = next[b])
+            test(b);
+        int cx = cell[a] / 2 % cellsX, cz = cell[a] / 2 / cellsX;
+        for (const auto& offset : FORWARD) {
+            int nx = cx + offset[0], nz = cz + offset[1];
+            if (nx < 0 || nx >= cellsX || nz >= cellsZ)
+                continue;
+            for (int32_t b = head[(nz * cellsX + nx) * 2]; b >= 0; b = next[b])
+                test(b);
+        }
+        if (!anyAsleep)
+            continue;
+        for (int nz = std::max(cz - 1, 0); nz <= std::min(cz + 1, cellsZ - 1); ++nz) {
+            for (int nx = std::max(cx - 1, 0); nx <= std::min(cx + 1, cellsX - 1); ++nx) {
+                for (int32_t b = head[(nz * cellsX + nx) * 2 + 1]; b >= 0; b = next[b])
+                    test(b);
+            }
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "CapsuleWorld.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Uniform grid over the terrain for finding which of a CapsuleWorld's
+// capsules might touch. Each capsule is linked into the cell holding its
+// centre; update() only relinks the ones that changed cell since the last
+// call, so a tick where agents walk a few centimetres touches a handful of
+// lists. Cells must be at least as wide as the widest capsule, so any two
+// capsules that touch are in the same or neighbouring cells. Beyond that,
+// smaller cells put fewer far-apart capsules in each candidate list, which
+// is what pair finding in a crowd costs; the terrain's spacing divided down
+// to just over the capsules' diameter works well. Sleeping capsules are kept
+// in a second list per cell, so pair finding reaches them from the awake side
+// without walking past them for pairs between awake ones.
+class CapsuleBroadphase {
+public:
+    // Cells of cellSize over [0, extentX] x [0, extentZ]. Capsules outside
+    // it go in the border cells.
+    void init(float extentX, float extentZ, float cellSize);
+
+    // Track the world's capsules: new ones are linked in, moved ones relinked.
+    // Only the awake capsules and the world's movedSlots are looked at, so
+    // call it after every step. A world that has shrunk since the last call
+    // is relinked from scratch.
+    void update(const CapsuleWorld& world);
+
+    // Pairs whose horizontal bounds overlap and at least one of which is
+    // awake, each once. Replaces the contents of pairs. Large awake ranges
+    // are split across the job system and the pieces' pairs joined in order,
+    // so they come out the same as from one thread.
+    void findPairs(const CapsuleWorld& world, std::vector<CapsulePair>& pairs) const;
+
+    // Awake capsules per pair-finding job
+    static const size_t PAIR_GRAIN = 1024;
+
+    int cellsX = 0, cellsZ = 0;
+    float cellSize = 1.0f;
+
+    // Stats from the last update
+    size_t relinked = 0;
+
+private:
+    std::vector<int32_t> head;      // first capsule in each list, -1 if none
+    std::vector<int32_t> next, prev;
+    std::vector<int32_t> cell;      // list each capsule is in: cell * 2, + 1 if asleep
+    size_t tracked = 0;
+    mutable std::vector<std::vector<CapsulePair>> rangePairs;  // per job, kept for their capacity
+
+    int cellOf(float x, float z) const;
+    void link(int32_t i, int32_t c);
+    void unlink(int32_t i);
+    void findPairsFrom(const CapsuleWorld& world, size_t begin, size_t end, std::vector<CapsulePair>& pairs) const;
+};
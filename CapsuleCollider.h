@@ -0,0 +1,70 @@
+#pragma once
+#include "TerrainCollider.h"
+#include <algorithm>
+
+// The player's upright capsule: falls under gravity and rests on the terrain
+// with its lowest point (height / 2 below the centre) on the surface.
+class CapsuleCollider {
+public:
+    float posX, posY, posZ;
+    float velocityY;
+    float capsuleRadius;
+    bool onGround;
+    float height;
+    const float gravity = -9.8f;
+
+    CapsuleCollider(float x, float y, float z, float height, float radius)
+        : posX(x), posY(y), posZ(z), height(height), capsuleRadius(radius),
+        velocityY(0), onGround(false) {
+    }
+
+    // getTerrainHeight(x, z) is any callable returning the terrain height
+    // under a point. It's a template parameter rather than a std::function
+    // so the sampler inlines into the update instead of costing an indirect
+    // call (and possibly an allocation) every tick.
+    template <typename HeightFn>
+    void update(float dt, HeightFn&& getTerrainHeight) {
+        // Gravity
+        velocityY += gravity * dt;
+
+        // Predict vertical position
+        float newY = posY + velocityY * dt;
+
+        // Terrain height at (x, z)
+        float terrainY = getTerrainHeight(posX, posZ);
+        float capsuleBottom = newY - height / 2.0f;
+
+        if (capsuleBottom <= terrainY) {
+            // Landed on terrain
+            newY = terrainY + height / 2.f;
+            velocityY = 0.0f;
+        }
+
+        posY = newY;
+    }
+
+    // One tick of walking by (dx, dz) and falling, with the whole capsule
+    // collided against the terrain's triangles: slides along slopes too
+    // steep to stand on and steps up rises below settings.stepHeight.
+    // update() only keeps the lowest point above one height sample.
+    void move(float dt, float dx, float dz, const TerrainCollider& terrain,
+        const CapsuleMoveSettings& settings = CapsuleMoveSettings()) {
+        velocityY += gravity * dt;
+        float startY = posY;
+        CapsuleMoveResult moved = terrain.moveCapsule(glm::vec3(posX, posY, posZ), glm::vec3(dx, velocityY * dt, dz),
+            height / 2.0f, capsuleRadius, onGround, settings);
+        posX = moved.position.x;
+        posY = moved.position.y;
+        posZ = moved.position.z;
+        onGround = moved.onGround;
+        if (onGround && velocityY < 0.0f)
+            velocityY = 0.0f;
+        else if (moved.hitSteep && velocityY < 0.0f)
+            velocityY = std::min(0.0f, std::max(velocityY, (posY - startY) / dt));  // no faster than it actually fell
+    }
+
+    void moveHorizontal(float dx, float dz) {
+        posX += dx;
+        posZ += dz;
+    }
+};
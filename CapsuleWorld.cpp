@@ -0,0 +1,377 @@
+#include "CapsuleWorld.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CAPSULE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+size_t paddedSize(size_t n) {
+    return (n + CapsuleWorld::BATCH - 1) / CapsuleWorld::BATCH * CapsuleWorld::BATCH;
+}
+}
+
+void CapsuleWorld::reserve(size_t capacity) {
+    size_t padded = paddedSize(capacity);
+    for (std::vector<float>* v : { &posX, &posY, &posZ, &velX, &velY, &velZ, &halfHeight, &radius })
+        v->reserve(padded);
+    onGround.reserve(padded);
+    stillTicks.reserve(padded);
+    ids.reserve(padded);
+    slots.reserve(capacity);
+    pendingWake.reserve(capacity);
+    // Each sleep or wake swaps two
+    movedSlots.reserve(capacity * 2);
+    // Separated capsules touch a few neighbours at most
+    contacts.reserve(capacity * 3);
+}
+
+uint32_t CapsuleWorld::add(const glm::vec3& position, float height, float capsuleRadius, const glm::vec3& velocity) {
+    if (count == posX.size()) {
+        size_t padded = paddedSize(count + 1);
+        for (std::vector<float>* v : { &posX, &posY, &posZ, &velX, &velY, &velZ, &halfHeight, &radius })
+            v->resize(padded, 0.0f);
+        onGround.resize(padded, 0);
+        stillTicks.resize(padded, 0);
+        ids.resize(padded, 0);
+    }
+    size_t i = count++;
+    posX[i] = position.x;
+    posY[i] = position.y;
+    posZ[i] = position.z;
+    velX[i] = velocity.x;
+    velY[i] = velocity.y;
+    velZ[i] = velocity.z;
+    halfHeight[i] = height * 0.5f;
+    radius[i] = capsuleRadius;
+    onGround[i] = 0;
+    stillTicks[i] = 0;
+    uint32_t id = (uint32_t)slots.size();
+    ids[i] = id;
+    slots.push_back((uint32_t)i);
+    // In front of the sleepers
+    swapSlots(i, awake++);
+    return id;
+}
+
+void CapsuleWorld::clear() {
+    for (std::vector<float>* v : { &posX, &posY, &posZ, &velX, &velY, &velZ, &halfHeight, &radius })
+        v->clear();
+    onGround.clear();
+    stillTicks.clear();
+    ids.clear();
+    slots.clear();
+    pendingWake.clear();
+    movedSlots.clear();
+    contacts.clear();
+    count = 0;
+    awake = 0;
+}
+
+// Also records i as moved when i == j: the capsule there is changing between
+// awake and asleep in place
+void CapsuleWorld::swapSlots(size_t i, size_t j) {
+    movedSlots.push_back((uint32_t)i);
+    if (i == j)
+        return;
+    for (std::vector<float>* v : { &posX, &posY, &posZ, &velX, &velY, &velZ, &halfHeight, &radius })
+        std::swap((*v)[i], (*v)[j]);
+    std::swap(onGround[i], onGround[j]);
+    std::swap(stillTicks[i], stillTicks[j]);
+    std::swap(ids[i], ids[j]);
+    slots[ids[i]] = (uint32_t)i;
+    slots[ids[j]] = (uint32_t)j;
+    movedSlots.push_back((uint32_t)j);
+}
+
+void CapsuleWorld::wake(size_t index) {
+    // A sleeper's count is cleared once it's due to wake, so it's queued once
+    if (index >= awake && index < count && stillTicks[index] != 0) {
+        stillTicks[index] = 0;
+        pendingWake.push_back(ids[index]);
+    }
+}
+
+size_t CapsuleWorld::wakeInRect(float minX, float minZ, float maxX, float maxZ) {
+    size_t woken = 0;
+    for (size_t i = awake; i < count; ++i) {
+        if (stillTicks[i] == 0 || posX[i] + radius[i] < minX || posX[i] - radius[i] > maxX
+            || posZ[i] + radius[i] < minZ || posZ[i] - radius[i] > maxZ)
+            continue;
+        wake(i);
+        ++woken;
+    }
+    return woken;
+}
+
+// Moves the capsules woken since the last step to the end of the awake range
+void CapsuleWorld::applyWakes() {
+    movedSlots.clear();
+    for (uint32_t id : pendingWake)
+        swapSlots(slots[id], awake++);
+    pendingWake.clear();
+}
+
+// One more step for the capsule at i, at rest or not; those that have
+// rested long enough are put to sleep once the step is done. Touches only
+// index i, so step()'s jobs can count their own capsules.
+void CapsuleWorld::countRest(size_t i, bool still) {
+    uint16_t& ticks = stillTicks[i];
+    if (!still)
+        ticks = 0;
+    else if (ticks < UINT16_MAX)
+        ++ticks;
+}
+
+// Moves the rested capsules past the end of the awake range, from the highest
+// index down, so the capsule swapped into each one's place has already been
+// looked at and is never another still to go. What's left of a sleeper's
+// velocity is dropped.
+void CapsuleWorld::sleepRested() {
+    for (size_t i = awake; i-- > 0;) {
+        if (stillTicks[i] < sleepTicks)
+            continue;
+        velX[i] = 0.0f;
+        velZ[i] = 0.0f;
+        swapSlots(i, --awake);
+    }
+}
+
+void CapsuleWorld::stepScalar(float dt, const HeightGrid& terrain) {
+    applyWakes();
+    const float maxX = terrain.extentX(), maxZ = terrain.extentZ();
+    const float restSpeed2 = sleepSpeed * sleepSpeed;
+    for (size_t i = 0; i < awake; ++i) {
+        velY[i] += gravity * dt;
+        float x = posX[i] + velX[i] * dt;
+        float z = posZ[i] + velZ[i] * dt;
+        float y = posY[i] + velY[i] * dt;
+
+        float cx = std::min(std::max(x, 0.0f), maxX);
+        float cz = std::min(std::max(z, 0.0f), maxZ);
+        if (cx != x)
+            velX[i] = -velX[i];
+        if (cz != z)
+            velZ[i] = -velZ[i];
+
+        float ground = terrain.sample(cx, cz);
+        bool contact = y - halfHeight[i] <= ground;
+        if (contact) {
+            y = ground + halfHeight[i];
+            velY[i] = 0.0f;
+        }
+        posX[i] = cx;
+        posY[i] = y;
+        posZ[i] = cz;
+        onGround[i] = contact ? 1 : 0;
+        countRest(i, contact && velX[i] * velX[i] + velZ[i] * velZ[i] < restSpeed2);
+    }
+    sleepRested();
+}
+
+void CapsuleWorld::step(float dt, const HeightGrid& terrain) {
+#if CAPSULE_SSE2
+    applyWakes();
+    const __m128 vdt = _mm_set1_ps(dt);
+    const __m128 vgravityDt = _mm_set1_ps(gravity * dt);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 maxX = _mm_set1_ps(terrain.extentX());
+    const __m128 maxZ = _mm_set1_ps(terrain.extentZ());
+    const __m128 spacing = _mm_set1_ps(terrain.spacing);
+    const __m128 lastSampleX = _mm_set1_ps(float(terrain.w - 1));
+    const __m128 lastSampleZ = _mm_set1_ps(float(terrain.h - 1));
+    const __m128 lastCellX = _mm_set1_ps(float(terrain.w - 2));
+    const __m128 lastCellZ = _mm_set1_ps(float(terrain.h - 2));
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    const __m128 restSpeed2 = _mm_set1_ps(sleepSpeed * sleepSpeed);
+    const float* heights = terrain.heights.data();
+    const size_t rowPitch = terrain.w;
+
+    // Whole batches of the awake range. The last may run into the sleepers,
+    // which are resting on the ground with no velocity, so stepping them
+    // puts them back where they were. Batches are independent, so they're
+    // split across the job system.
+    const size_t batches = paddedSize(awake) / BATCH;
+    JobSystem::instance().parallelFor(0, batches, STEP_GRAIN / BATCH, [&](size_t first, size_t last) {
+        for (size_t i = first * BATCH; i < last * BATCH; i += BATCH) {
+            __m128 vy = _mm_add_ps(_mm_loadu_ps(&velY[i]), vgravityDt);
+            __m128 vx = _mm_loadu_ps(&velX[i]);
+            __m128 vz = _mm_loadu_ps(&velZ[i]);
+            __m128 x = _mm_add_ps(_mm_loadu_ps(&posX[i]), _mm_mul_ps(vx, vdt));
+            __m128 z = _mm_add_ps(_mm_loadu_ps(&posZ[i]), _mm_mul_ps(vz, vdt));
+            __m128 y = _mm_add_ps(_mm_loadu_ps(&posY[i]), _mm_mul_ps(vy, vdt));
+
+            // Keep to the terrain, reversing the velocity of lanes that hit an edge
+            __m128 cx = _mm_min_ps(_mm_max_ps(x, zero), maxX);
+            __m128 cz = _mm_min_ps(_mm_max_ps(z, zero), maxZ);
+            vx = _mm_xor_ps(vx, _mm_and_ps(_mm_cmpneq_ps(cx, x), signBit));
+            vz = _mm_xor_ps(vz, _mm_and_ps(_mm_cmpneq_ps(cz, z), signBit));
+
+            // Bilinear terrain height: cell and weights for four lanes at once;
+            // SSE2 has no gather, so the 16 corner samples are loaded per lane
+            __m128 fx = _mm_min_ps(_mm_max_ps(_mm_div_ps(cx, spacing), zero), lastSampleX);
+            __m128 fz = _mm_min_ps(_mm_max_ps(_mm_div_ps(cz, spacing), zero), lastSampleZ);
+            __m128 x0 = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(fx)), lastCellX);
+            __m128 z0 = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(fz)), lastCellZ);
+            __m128 tx = _mm_sub_ps(fx, x0);
+            __m128 tz = _mm_sub_ps(fz, z0);
+
+            alignas(16) int cellX[4], cellZ[4];
+            alignas(16) float h00[4], h10[4], h01[4], h11[4];
+            _mm_store_si128((__m128i*)cellX, _mm_cvttps_epi32(x0));
+            _mm_store_si128((__m128i*)cellZ, _mm_cvttps_epi32(z0));
+            for (int k = 0; k < 4; ++k) {
+                const float* corner = heights + cellZ[k] * rowPitch + cellX[k];
+                h00[k] = corner[0];
+                h10[k] = corner[1];
+                h01[k] = corner[rowPitch];
+                h11[k] = corner[rowPitch + 1];
+            }
+            __m128 a = _mm_load_ps(h00), b = _mm_load_ps(h10), c = _mm_load_ps(h01), d = _mm_load_ps(h11);
+            __m128 hx0 = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), tx));
+            __m128 hx1 = _mm_add_ps(c, _mm_mul_ps(_mm_sub_ps(d, c), tx));
+            __m128 ground = _mm_add_ps(hx0, _mm_mul_ps(_mm_sub_ps(hx1, hx0), tz));
+
+            // Contact: snap to the surface and stop falling
+            __m128 half = _mm_loadu_ps(&halfHeight[i]);
+            __m128 contact = _mm_cmple_ps(_mm_sub_ps(y, half), ground);
+            y = _mm_or_ps(_mm_and_ps(contact, _mm_add_ps(ground, half)), _mm_andnot_ps(contact, y));
+            vy = _mm_andnot_ps(contact, vy);
+
+            _mm_storeu_ps(&posX[i], cx);
+            _mm_storeu_ps(&posY[i], y);
+            _mm_storeu_ps(&posZ[i], cz);
+            _mm_storeu_ps(&velX[i], vx);
+            _mm_storeu_ps(&velY[i], vy);
+            _mm_storeu_ps(&velZ[i], vz);
+            int mask = _mm_movemask_ps(contact);
+            __m128 speed2 = _mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vz, vz));
+            int still = _mm_movemask_ps(_mm_and_ps(contact, _mm_cmplt_ps(speed2, restSpeed2)));
+            for (int k = 0; k < 4; ++k)
+                onGround[i + k] = (mask >> k) & 1;
+            for (size_t k = 0; k < BATCH && i + k < awake; ++k)
+                countRest(i + k, (still >> k) & 1);
+        }
+    });
+    sleepRested();
+#else
+    stepScalar(dt, terrain);
+#endif
+}
+
+// Overlap of capsules a and b: their vertical segments' gap, squared,
+// against the sum of their radii. collide()'s SSE2 lanes do the same
+// operations in the same order.
+bool CapsuleWorld::overlaps(uint32_t a, uint32_t b) const {
+    float dx = posX[a] - posX[b], dy = posY[a] - posY[b], dz = posZ[a] - posZ[b];
+    float segments = std::max(halfHeight[a] - radius[a], 0.0f) + std::max(halfHeight[b] - radius[b], 0.0f);
+    float gapY = std::max(std::abs(dy) - segments, 0.0f);
+    float reach = radius[a] + radius[b];
+    return dx * dx + dz * dz + gapY * gapY < reach * reach;
+}
+
+void CapsuleWorld::addContact(uint32_t a, uint32_t b) {
+    float dx = posX[a] - posX[b], dy = posY[a] - posY[b], dz = posZ[a] - posZ[b];
+    float segments = std::max(halfHeight[a] - radius[a], 0.0f) + std::max(halfHeight[b] - radius[b], 0.0f);
+    float gapY = std::max(std::abs(dy) - segments, 0.0f);
+    float horizontal = std::sqrt(dx * dx + dz * dz);
+
+    CapsuleContact contact;
+    contact.a = a;
+    contact.b = b;
+    contact.depth = radius[a] + radius[b] - std::sqrt(horizontal * horizontal + gapY * gapY);
+    // Axes in line: part them along x
+    contact.normalX = horizontal > 1e-6f ? dx / horizontal : 1.0f;
+    contact.normalZ = horizontal > 1e-6f ? dz / horizontal : 0.0f;
+    contacts.push_back(contact);
+}
+
+void CapsuleWorld::applyContacts() {
+    for (const CapsuleContact& c : contacts) {
+        // Being pushed isn't resting, and wakes sleepers once the contacts
+        // are in; a shallower touch leaves a sleeper, and the capsule
+        // touching it, where they are
+        if (c.depth > wakeDepth) {
+            for (uint32_t i : { c.a, c.b }) {
+                wake(i);
+                stillTicks[i] = 0;
+            }
+        } else if (isAsleep(c.a) || isAsleep(c.b)) {
+            continue;
+        }
+
+        float push = c.depth * 0.5f;
+        posX[c.a] += c.normalX * push;
+        posZ[c.a] += c.normalZ * push;
+        posX[c.b] -= c.normalX * push;
+        posZ[c.b] -= c.normalZ * push;
+
+        float closing = (velX[c.a] - velX[c.b]) * c.normalX + (velZ[c.a] - velZ[c.b]) * c.normalZ;
+        if (closing < 0.0f) {
+            velX[c.a] -= closing * c.normalX;
+            velZ[c.a] -= closing * c.normalZ;
+            velX[c.b] += closing * c.normalX;
+            velZ[c.b] += closing * c.normalZ;
+        }
+    }
+}
+
+size_t CapsuleWorld::collideScalar(const std::vector<CapsulePair>& pairs) {
+    contacts.clear();
+    for (const CapsulePair& pair : pairs) {
+        if (overlaps(pair.a, pair.b))
+            addContact(pair.a, pair.b);
+    }
+    applyContacts();
+    return contacts.size();
+}
+
+size_t CapsuleWorld::collide(const std::vector<CapsulePair>& pairs) {
+    contacts.clear();
+    size_t i = 0;
+#if CAPSULE_SSE2
+    // Most pairs from the broadphase don't touch, so the lanes only decide
+    // which do; contacts are built one at a time from the mask
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    for (; i + 4 <= pairs.size(); i += 4) {
+        alignas(16) float ax[4], ay[4], az[4], ah[4], ar[4], bx[4], by[4], bz[4], bh[4], br[4];
+        for (int k = 0; k < 4; ++k) {
+            uint32_t a = pairs[i + k].a, b = pairs[i + k].b;
+            ax[k] = posX[a];
+            ay[k] = posY[a];
+            az[k] = posZ[a];
+            ah[k] = halfHeight[a];
+            ar[k] = radius[a];
+            bx[k] = posX[b];
+            by[k] = posY[b];
+            bz[k] = posZ[b];
+            bh[k] = halfHeight[b];
+            br[k] = radius[b];
+        }
+        __m128 ra = _mm_load_ps(ar), rb = _mm_load_ps(br);
+        __m128 dx = _mm_sub_ps(_mm_load_ps(ax), _mm_load_ps(bx));
+        __m128 dy = _mm_sub_ps(_mm_load_ps(ay), _mm_load_ps(by));
+        __m128 dz = _mm_sub_ps(_mm_load_ps(az), _mm_load_ps(bz));
+        __m128 segments = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(ah), ra), zero),
+            _mm_max_ps(_mm_sub_ps(_mm_load_ps(bh), rb), zero));
+        __m128 gapY = _mm_max_ps(_mm_sub_ps(_mm_andnot_ps(signBit, dy), segments), zero);
+        __m128 reach = _mm_add_ps(ra, rb);
+        __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dz, dz)), _mm_mul_ps(gapY, gapY));
+        int mask = _mm_movemask_ps(_mm_cmplt_ps(d2, _mm_mul_ps(reach, reach)));
+        for (int k = 0; mask; ++k, mask >>= 1) {
+            if (mask & 1)
+                addContact(pairs[i + k].a, pairs[i + k].b);
+        }
+    }
+#endif
+    for (; i < pairs.size(); ++i) {
+        if (overlaps(pairs[i].a, pairs[i].b))
+            addContact(pairs[i].a, pairs[i].b);
+    }
+    applyContacts();
+    return contacts.size();
+}
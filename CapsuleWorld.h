@@ -0,0 +1,112 @@
+#pragma once
+#include "HeightGrid.h"
+#include <glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Two capsules that may touch, by index, as a broadphase finds them
+struct CapsulePair {
+    uint32_t a, b;
+};
+
+struct CapsuleContact {
+    uint32_t a, b;
+    float normalX, normalZ;     // horizontal, from b towards a
+    float depth;
+};
+
+// Upright capsules (agents) stored as structure-of-arrays and stepped four at
+// a time with SSE2 where it's available. The contact model is CapsuleCollider's:
+// gravity pulls each capsule down and, once its lowest point (halfHeight
+// below the centre) reaches the terrain, it's put back on the surface and its
+// fall stops. Capsules also move horizontally at their velocity and bounce
+// off the edges of the terrain, and off each other through collide(). The
+// arrays are padded to a whole batch; the padding lanes are stepped along
+// with the rest and never read.
+//
+// A grounded capsule that has stayed slower than sleepSpeed, and hasn't been
+// pushed deeper than wakeDepth by another, for sleepTicks steps falls asleep.
+// Sleeping capsules are kept after the awake ones in the arrays, so step()
+// and the broadphase's pair finding stop at awakeCount() and an idle crowd
+// costs nothing per tick. A capsule wakes when an awake one touches it or
+// through wakeInRect() when the terrain under it changes; either takes
+// effect at the start of the next step. Moving a capsule between the two
+// ranges swaps it with another, so indices change; ids don't.
+class CapsuleWorld {
+public:
+    static const size_t BATCH = 4;
+
+    std::vector<float> posX, posY, posZ;
+    std::vector<float> velX, velY, velZ;
+    std::vector<float> halfHeight;      // centre to lowest point
+    std::vector<float> radius;
+    std::vector<uint8_t> onGround;      // 1 if the last step ended in contact
+    std::vector<uint16_t> stillTicks;   // steps in a row at rest
+    std::vector<uint32_t> ids;          // of the capsule at each index
+    float gravity = -9.8f;
+
+    float sleepSpeed = 0.05f;           // horizontal speed at rest; 0 keeps every capsule awake
+    float wakeDepth = 0.01f;            // contacts deeper than this aren't at rest, and wake sleepers
+    int sleepTicks = 30;                // steps at rest before a capsule sleeps
+
+    // Indices whose capsule fell asleep, woke or was swapped with one that
+    // did in the last step(), so a broadphase can refresh them along with
+    // the awake range
+    std::vector<uint32_t> movedSlots;
+
+    std::vector<CapsuleContact> contacts;   // from the last collide()
+
+    void reserve(size_t capacity);
+    // height is tip to tip, as for CapsuleCollider. The capsule starts awake.
+    // Returns its id.
+    uint32_t add(const glm::vec3& position, float height, float radius, const glm::vec3& velocity = glm::vec3(0.0f));
+    void clear();
+    size_t size() const { return count; }
+
+    // Capsules [0, awakeCount()) are awake, the rest asleep
+    size_t awakeCount() const { return awake; }
+    bool isAsleep(size_t index) const { return index >= awake; }
+    size_t indexOf(uint32_t id) const { return slots[id]; }
+
+    // Wakes the capsule at index at the start of the next step
+    void wake(size_t index);
+
+    // Wakes sleeping capsules whose footprint overlaps [minX, maxX] x
+    // [minZ, maxZ], after an edit to the terrain there. Returns how many.
+    size_t wakeInRect(float minX, float minZ, float maxX, float maxZ);
+
+    // Large awake ranges are split across the job system, STEP_GRAIN
+    // capsules per job
+    void step(float dt, const HeightGrid& terrain);
+    static const size_t STEP_GRAIN = 2048;
+
+    // The same step one capsule at a time, through HeightGrid::sample. Gives
+    // bit-identical results; kept as the reference and for benchmarking.
+    void stepScalar(float dt, const HeightGrid& terrain);
+
+    // Tests pairs (from CapsuleBroadphase) four at a time, then separates each
+    // overlapping pair horizontally, half each, and, if they're closing,
+    // swaps their velocities along the contact normal: equal masses bouncing
+    // elastically. Contacts all come from the positions before any is
+    // applied. Sleeping capsules touched deeper than wakeDepth are pushed
+    // too, and wake. Returns the number of contacts.
+    size_t collide(const std::vector<CapsulePair>& pairs);
+
+    // The same one pair at a time; bit-identical, as with stepScalar
+    size_t collideScalar(const std::vector<CapsulePair>& pairs);
+
+private:
+    size_t count = 0;
+    size_t awake = 0;
+    std::vector<uint32_t> slots;        // index of each id
+    std::vector<uint32_t> pendingWake;  // ids
+
+    void swapSlots(size_t i, size_t j);
+    void applyWakes();
+    void countRest(size_t i, bool still);
+    void sleepRested();
+    bool overlaps(uint32_t a, uint32_t b) const;
+    void addContact(uint32_t a, uint32_t b);
+    void applyContacts();
+};
@@ -0,0 +1,69 @@
+#include "ChunkBuilder.h"
+#include "Profiler.h"
+#include <algorithm>
+
+ChunkBuilder::ChunkBuilder(const std::vector<std::vector<float>>& heightMap, const std::vector<TerrainChunk>& chunks,
+    float spacing, size_t poolSize)
+    : heightMap(heightMap), chunks(chunks), spacing(spacing), pool(poolSize), completed(poolSize) {
+    // Staging buffers are sized for the largest chunk up front, so no build
+    // ever grows one
+    size_t maxCells = 0, maxVertices = 0;
+    for (const TerrainChunk& c : chunks) {
+        maxCells = std::max(maxCells, size_t(c.cellsW) * c.cellsH);
+        maxVertices = std::max(maxVertices, size_t(c.cellsW + 1) * (c.cellsH + 1));
+    }
+    freeList.reserve(poolSize);
+    for (StagedChunk& staged : pool) {
+        staged.mesh.vertices.reserve(maxVertices * 3);
+        staged.mesh.indices.reserve(maxCells * 6);
+        freeList.push_back(&staged);
+    }
+}
+
+ChunkBuilder::~ChunkBuilder() {
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+        requests.clear();
+    }
+    JobSystem::instance().wait(inFlight);
+}
+
+void ChunkBuilder::request(int chunkIndex) {
+    std::lock_guard<std::mutex> lock(requestMutex);
+    requests.push_back(chunkIndex);
+    dispatch();
+}
+
+StagedChunk* ChunkBuilder::popCompleted() {
+    StagedChunk* staged = nullptr;
+    completed.pop(staged);
+    return staged;
+}
+
+void ChunkBuilder::release(StagedChunk* staged) {
+    staged->chunkIndex = -1;
+    std::lock_guard<std::mutex> lock(requestMutex);
+    freeList.push_back(staged);
+    dispatch();
+}
+
+size_t ChunkBuilder::pendingRequests() {
+    std::lock_guard<std::mutex> lock(requestMutex);
+    return requests.size();
+}
+
+void ChunkBuilder::dispatch() {
+    while (!requests.empty() && !freeList.empty()) {
+        StagedChunk* staged = freeList.back();
+        freeList.pop_back();
+        staged->chunkIndex = requests.front();
+        requests.pop_front();
+
+        JobSystem::instance().run([this, staged] {
+            PROFILE_ZONE("Build chunk");
+            buildChunkMesh(heightMap, spacing, chunks[staged->chunkIndex], staged->mesh);
+            // Can't fail: the queue holds the whole pool
+            completed.push(staged);
+        }, &inFlight);
+    }
+}
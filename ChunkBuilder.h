@@ -0,0 +1,52 @@
+#pragma once
+#include "TerrainChunks.h"
+#include "LockFreeQueue.h"
+#include "JobSystem.h"
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// A chunk mesh built off the GL thread, living in a pooled staging buffer
+struct StagedChunk {
+    int chunkIndex = -1;
+    ChunkMesh mesh;
+};
+
+// Builds chunk meshes as jobs. Each build fills a StagedChunk taken from a
+// fixed pool (vectors are reserved for the largest chunk, so building never
+// allocates) and publishes it on a lock-free queue; the GL thread pops them,
+// uploads, and hands the staging buffer back with release(), which starts
+// the next queued request. At most poolSize builds are in flight.
+class ChunkBuilder {
+public:
+    ChunkBuilder(const std::vector<std::vector<float>>& heightMap, const std::vector<TerrainChunk>& chunks,
+        float spacing, size_t poolSize = 16);
+    ~ChunkBuilder();
+
+    ChunkBuilder(const ChunkBuilder&) = delete;
+    ChunkBuilder& operator=(const ChunkBuilder&) = delete;
+
+    void request(int chunkIndex);
+
+    // GL thread side
+    StagedChunk* popCompleted();
+    void release(StagedChunk* staged);
+
+    size_t pendingRequests();
+
+private:
+    const std::vector<std::vector<float>>& heightMap;
+    const std::vector<TerrainChunk>& chunks;
+    float spacing;
+
+    std::vector<StagedChunk> pool;
+    LockFreeQueue<StagedChunk*> completed;
+
+    std::mutex requestMutex;
+    std::deque<int> requests;
+    std::vector<StagedChunk*> freeList;
+    JobCounter inFlight;
+
+    // Caller holds requestMutex
+    void dispatch();
+};
@@ -0,0 +1,88 @@
+#include "ChunkUploader.h"
+#include <chrono>
+#include <cstring>
+
+void ChunkUploader::init(std::vector<TerrainChunk>& chunks, int chunkCells) {
+    const size_t slotVerts = size_t(chunkCells + 1) * (chunkCells + 1);
+    const size_t slotIndices = size_t(chunkCells) * chunkCells * 6;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        chunks[i].baseVertex = (int)(i * slotVerts);
+        chunks[i].firstIndex = (unsigned int)(i * slotIndices);
+        chunks[i].indexCount = 0;
+    }
+    resident.assign(chunks.size(), 0);
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, chunks.size() * slotVerts * 3 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, chunks.size() * slotIndices * sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW);
+    glBindVertexArray(0);
+}
+
+void ChunkUploader::pump(ChunkBuilder& builder, std::vector<TerrainChunk>& chunks, StreamBuffer& stream, GLStateCache& state,
+                         size_t budgetBytes, float budgetMs) {
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    uploadedBytes = 0;
+    uploadedChunks = 0;
+
+    // The VAO carries the EBO binding the index copies target
+    state.bindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    for (;;) {
+        StagedChunk* staged = carried ? carried : builder.popCompleted();
+        carried = nullptr;
+        if (!staged)
+            break;
+
+        const ChunkMesh& mesh = staged->mesh;
+        const size_t vertexBytes = mesh.vertices.size() * sizeof(float);
+        const size_t indexBytes = mesh.indices.size() * sizeof(unsigned int);
+
+        // Always make progress, otherwise stop at the first mesh over budget
+        if (uploadedChunks > 0 && uploadedBytes + vertexBytes + indexBytes > budgetBytes) {
+            carried = staged;
+            break;
+        }
+
+        TerrainChunk& c = chunks[staged->chunkIndex];
+        const size_t vertexDst = size_t(c.baseVertex) * 3 * sizeof(float);
+        const size_t indexDst = size_t(c.firstIndex) * sizeof(unsigned int);
+        size_t src = 0;
+        if (char* dst = (char*)stream.map(vertexBytes + indexBytes, 16, src)) {
+            std::memcpy(dst, mesh.vertices.data(), vertexBytes);
+            std::memcpy(dst + vertexBytes, mesh.indices.data(), indexBytes);
+            stream.unmap();
+            glBindBuffer(GL_COPY_READ_BUFFER, stream.buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_ARRAY_BUFFER, src, vertexDst, vertexBytes);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_ELEMENT_ARRAY_BUFFER, src + vertexBytes, indexDst, indexBytes);
+        }
+        else {
+            glBufferSubData(GL_ARRAY_BUFFER, vertexDst, vertexBytes, mesh.vertices.data());
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexDst, indexBytes, mesh.indices.data());
+        }
+        c.indexCount = (unsigned int)mesh.indices.size();
+        resident[staged->chunkIndex] = 1;
+        builder.release(staged);
+
+        uploadedBytes += vertexBytes + indexBytes;
+        ++uploadedChunks;
+        if (std::chrono::duration<float, std::milli>(Clock::now() - start).count() >= budgetMs)
+            break;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    uploadMs = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+void ChunkUploader::destroy() {
+    glDeleteBuffers(1, &ebo);
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+    vao = vbo = ebo = 0;
+}
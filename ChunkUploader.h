@@ -0,0 +1,32 @@
+#pragma once
+#include "ChunkBuilder.h"
+#include "StreamBuffer.h"
+#include "GLStateCache.h"
+#include <glad/gl.h>
+#include <vector>
+
+// GL thread half of chunk streaming. Every chunk owns a fixed slot in one
+// shared VBO/EBO; completed meshes from a ChunkBuilder are written into the
+// streaming ring and copied into their slot on the GPU with
+// glCopyBufferSubData, but only as many per frame as fit in the byte and
+// time budgets, so streaming never shows up as a frame spike.
+class ChunkUploader {
+public:
+    GLuint vao = 0, vbo = 0, ebo = 0;
+    std::vector<char> resident;
+
+    // Stats for the last pump()
+    size_t uploadedBytes = 0;
+    size_t uploadedChunks = 0;
+    float uploadMs = 0.0f;
+
+    // Assigns baseVertex/firstIndex slots to the chunks and allocates storage
+    void init(std::vector<TerrainChunk>& chunks, int chunkCells);
+    // Falls back to glBufferSubData for meshes the ring can't take
+    void pump(ChunkBuilder& builder, std::vector<TerrainChunk>& chunks, StreamBuffer& stream, GLStateCache& state,
+              size_t budgetBytes, float budgetMs);
+    void destroy();
+
+private:
+    StagedChunk* carried = nullptr;     // popped but over budget, uploaded next frame
+};
@@ -0,0 +1,166 @@
+#include "ClipmapRenderer.h"
+#include <vector>
+
+const char* clipmapVertSrc = R"(
+#version 330 core
+layout(location = 0) in vec2 gridPos;
+out float vHeight;
+layout(std140) uniform Frame {
+    mat4 mvp;
+    vec4 cameraPos;
+};
+layout(std140) uniform ClipmapLevel {
+    vec4 originScale;           // first resident sample of this level, cells per sample, level
+    vec4 params;                // spacing, ringSize, half the grid in level samples, transition width
+    ivec4 flags;                // hasCoarser
+};
+uniform sampler2DArray heightTex;
+
+void main() {
+    vec2 origin = originScale.xy;
+    float levelScale = originScale.z;
+    int level = int(originScale.w);
+    float spacing = params.x;
+    float ringSize = params.y;
+    float halfExtent = params.z;
+    float transitionWidth = params.w;
+    bool hasCoarser = flags.x != 0;
+
+    vec2 s = origin + gridPos;
+    float h = texelFetch(heightTex, ivec3(ivec2(mod(s, ringSize)), level), 0).r;
+
+    // Blend towards the coarser level near the outer edge so the boundary
+    // vertices match it exactly and no cracks open between levels
+    vec2 d = abs(gridPos - halfExtent);
+    vec2 a = clamp((d - (halfExtent - transitionWidth)) / transitionWidth, 0.0, 1.0);
+    float alpha = hasCoarser ? max(a.x, a.y) : 0.0;
+    if (alpha > 0.0) {
+        vec2 uv = (s * 0.5 + 0.5) / ringSize;
+        h = mix(h, texture(heightTex, vec3(uv, float(level + 1))).r, alpha);
+    }
+
+    vec3 world = vec3(s.x * levelScale * spacing, h, s.y * levelScale * spacing);
+    gl_Position = mvp * vec4(world, 1.0);
+    vHeight = h;
+})";
+
+void ClipmapRenderer::init(const GeometryClipmap& clipmap, GLuint prog) {
+    program = prog;
+    bindUniformBlock(program, "Frame", FRAME_UNIFORM_BINDING);
+    bindUniformBlock(program, "ClipmapLevel", DRAW_UNIFORM_BINDING);
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "heightTex"), 0);
+
+    const int n = clipmap.gridQuads;
+    const int hole = n / 2;
+    holeBase = clipmap.ringSize / 4;
+
+    std::vector<float> grid;
+    for (int z = 0; z <= n; ++z) {
+        for (int x = 0; x <= n; ++x) {
+            grid.push_back((float)x);
+            grid.push_back((float)z);
+        }
+    }
+
+    std::vector<unsigned int> indices;
+    auto emitGrid = [&](int holeX, int holeZ, bool withHole) {
+        for (int z = 0; z < n; ++z) {
+            for (int x = 0; x < n; ++x) {
+                if (withHole && x >= holeX && x < holeX + hole && z >= holeZ && z < holeZ + hole)
+                    continue;
+                unsigned int v0 = z * (n + 1) + x;
+                unsigned int v1 = v0 + 1;
+                unsigned int v2 = v0 + (n + 1);
+                unsigned int v3 = v2 + 1;
+                indices.insert(indices.end(), { v0, v2, v1, v1, v2, v3 });
+            }
+        }
+    };
+    emitGrid(0, 0, false);
+    fullIndexCount = (GLsizei)indices.size();
+    for (int i = 0; i < 4; ++i)
+        emitGrid(holeBase + (i & 1), holeBase + (i >> 1), true);
+    ringIndexCount = (GLsizei)(indices.size() - fullIndexCount) / 4;
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, grid.size() * sizeof(float), grid.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+
+    glGenTextures(1, &heightTex);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, heightTex);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R32F, clipmap.ringSize, clipmap.ringSize, clipmap.levelCount,
+        0, GL_RED, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+size_t ClipmapRenderer::ringOffset(int holeX, int holeZ) const {
+    int variant = (holeX - holeBase) + (holeZ - holeBase) * 2;
+    return (size_t(fullIndexCount) + size_t(variant) * ringIndexCount) * sizeof(unsigned int);
+}
+
+void ClipmapRenderer::upload(const GeometryClipmap& clipmap, GLStateCache& state) {
+    if (clipmap.pendingUploads.empty())
+        return;
+
+    state.bindTexture(0, GL_TEXTURE_2D_ARRAY, heightTex);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (const ClipmapUpload& up : clipmap.pendingUploads) {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, up.texX, up.texZ, up.level, up.w, up.h, 1,
+            GL_RED, GL_FLOAT, clipmap.staging.data() + up.dataOffset);
+    }
+}
+
+void ClipmapRenderer::draw(const GeometryClipmap& clipmap, StreamBuffer& stream, GLStateCache& state) {
+    lastTriangleCount = 0;
+    const int finest = clipmap.finestActiveLevel();
+    if (finest >= clipmap.levelCount)
+        return;
+
+    state.useProgram(program);
+    state.bindTexture(0, GL_TEXTURE_2D_ARRAY, heightTex);
+    state.bindVertexArray(vao);
+
+    const glm::vec4 params(clipmap.spacing, (float)clipmap.ringSize, clipmap.gridQuads * 0.5f, clipmap.gridQuads / 10.0f);
+    for (int level = finest; level < clipmap.levelCount; ++level) {
+        const ClipmapLevel& l = clipmap.levels[level];
+        ClipmapLevelUniforms block;
+        block.originScale = glm::vec4((float)l.originX, (float)l.originZ, float(1 << level), (float)level);
+        block.params = params;
+        block.flags = glm::ivec4(level + 1 < clipmap.levelCount, 0, 0, 0);
+        pushUniformBlock(stream, DRAW_UNIFORM_BINDING, block);
+
+        if (level == finest) {
+            glDrawElements(GL_TRIANGLES, fullIndexCount, GL_UNSIGNED_INT, (void*)0);
+            lastTriangleCount += fullIndexCount / 3;
+        }
+        else {
+            const ClipmapLevel& inner = clipmap.levels[level - 1];
+            int holeX = inner.originX / 2 - l.originX;
+            int holeZ = inner.originZ / 2 - l.originZ;
+            glDrawElements(GL_TRIANGLES, ringIndexCount, GL_UNSIGNED_INT, (void*)ringOffset(holeX, holeZ));
+            lastTriangleCount += ringIndexCount / 3;
+        }
+    }
+}
+
+void ClipmapRenderer::destroy() {
+    glDeleteTextures(1, &heightTex);
+    glDeleteBuffers(1, &ebo);
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+    vao = vbo = ebo = heightTex = 0;
+}
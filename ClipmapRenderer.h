@@ -0,0 +1,32 @@
+#pragma once
+#include "GeometryClipmap.h"
+#include "GLStateCache.h"
+#include "UniformBlocks.h"
+#include <glad/gl.h>
+#include <glm.hpp>
+
+extern const char* clipmapVertSrc;
+
+// GL side of GeometryClipmap: one R32F texture array layer per level, filled
+// with glTexSubImage3D from the clipmap's pending uploads, and one shared
+// grid drawn per active level. The finest active level draws the full grid;
+// coarser levels draw a ring whose hole matches the level inside them.
+class ClipmapRenderer {
+public:
+    GLuint program = 0;
+    GLuint vao = 0, vbo = 0, ebo = 0, heightTex = 0;
+    GLsizei fullIndexCount = 0, ringIndexCount = 0;
+    size_t lastTriangleCount = 0;
+
+    // prog must be linked from clipmapVertSrc. draw() expects the Frame block
+    // bound and pushes one ClipmapLevel block per level it draws.
+    void init(const GeometryClipmap& clipmap, GLuint prog);
+    void upload(const GeometryClipmap& clipmap, GLStateCache& state);
+    void draw(const GeometryClipmap& clipmap, StreamBuffer& stream, GLStateCache& state);
+    void destroy();
+
+private:
+    // Ring variants: the hole sits ringSize / 4 or one more samples in on each axis
+    size_t ringOffset(int holeX, int holeZ) const;
+    int holeBase = 0;
+};
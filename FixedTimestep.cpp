@@ -0,0 +1,31 @@
+#include "FixedTimestep.h"
+#include <algorithm>
+
+FixedTimestep::FixedTimestep(float tickRate, int maxTicksPerFrame)
+    : tickLength(1.0 / tickRate), maxTicksPerFrame(std::max(1, maxTicksPerFrame)) {
+}
+
+void FixedTimestep::setTickRate(float tickRate) {
+    // Keep alpha where it was
+    double a = accumulator / tickLength;
+    tickLength = 1.0 / std::max(1.0f, tickRate);
+    accumulator = a * tickLength;
+}
+
+int FixedTimestep::advance(double frameSeconds) {
+    accumulator += std::max(0.0, frameSeconds);
+
+    double maxBacklog = maxTicksPerFrame * tickLength;
+    if (accumulator > maxBacklog + tickLength) {
+        droppedSeconds += accumulator - maxBacklog;
+        accumulator = maxBacklog;
+    }
+
+    int count = 0;
+    while (accumulator >= tickLength && count < maxTicksPerFrame) {
+        accumulator -= tickLength;
+        ++count;
+    }
+    ticks += count;
+    return count;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+
+// Fixed-rate simulation clock. Each frame adds its real elapsed time and gets
+// back the number of whole ticks to simulate; the leftover fraction of a tick
+// is alpha(), for interpolating between the last two simulated states.
+// Catching up is capped at maxTicksPerFrame so a long hitch slows the
+// simulation down instead of stalling every following frame.
+class FixedTimestep {
+public:
+    uint64_t ticks = 0;             // simulated so far
+    double droppedSeconds = 0.0;    // time discarded by the catch-up cap
+
+    explicit FixedTimestep(float tickRate = 60.0f, int maxTicksPerFrame = 8);
+
+    void setTickRate(float tickRate);
+    float tickRate() const { return 1.0f / (float)tickLength; }
+    float tickSeconds() const { return (float)tickLength; }
+
+    // Returns the ticks to run this frame
+    int advance(double frameSeconds);
+
+    // 0 = previous tick's state, 1 = latest tick's state
+    float alpha() const { return (float)(accumulator / tickLength); }
+
+private:
+    double tickLength;
+    double accumulator = 0.0;
+    int maxTicksPerFrame;
+};
@@ -0,0 +1,54 @@
+#include "FrameArena.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+// Room for overflow blocks without the chain itself reallocating
+const size_t MAX_CHAINED_BLOCKS = 16;
+}
+
+FrameArena::FrameArena(size_t initialBytes) {
+    blocks.reserve(MAX_CHAINED_BLOCKS);
+    addBlock(std::max<size_t>(initialBytes, 256));
+}
+
+void FrameArena::addBlock(size_t size) {
+    blocks.push_back({ std::make_unique<unsigned char[]>(size), size });
+    used = 0;
+    ++blockAllocations;
+}
+
+void FrameArena::reset() {
+    if (blocks.size() > 1) {
+        size_t total = capacity();
+        blocks.clear();
+        addBlock(total);
+    }
+    used = 0;
+    frameBytes = 0;
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+    auto alignedOffset = [&](const Block& block, size_t offset) {
+        uintptr_t base = (uintptr_t)block.data.get();
+        return size_t((base + offset + alignment - 1) / alignment * alignment - base);
+    };
+
+    size_t offset = alignedOffset(blocks.back(), used);
+    if (offset + size > blocks.back().size) {
+        addBlock(std::max(blocks.back().size * 2, size + alignment));
+        offset = alignedOffset(blocks.back(), 0);
+    }
+
+    used = offset + size;
+    frameBytes += size;
+    peakBytes = std::max(peakBytes, frameBytes);
+    return blocks.back().data.get() + offset;
+}
+
+size_t FrameArena::capacity() const {
+    size_t total = 0;
+    for (const Block& block : blocks)
+        total += block.size;
+    return total;
+}
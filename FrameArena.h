@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Linear allocator for data that only lives until the end of the frame.
+// allocate() bumps an offset through the current block and reset() at the
+// start of the next frame releases everything at once. A frame that
+// overflows chains on a bigger block; the next reset() folds the chain into
+// one block of the combined size, so once the peak has been seen the arena
+// stops touching the heap. Nothing is ever destructed, so only trivially
+// destructible types may be created in it.
+class FrameArena {
+public:
+    // Stats
+    size_t frameBytes = 0;          // handed out since the last reset()
+    size_t peakBytes = 0;           // largest frameBytes seen
+    size_t blockAllocations = 0;    // heap allocations, including the first block
+
+    explicit FrameArena(size_t initialBytes = 64 * 1024);
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Invalidates every pointer handed out since the last reset()
+    void reset();
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        static_assert(std::is_trivially_destructible_v<T>, "FrameArena never runs destructors");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Uninitialized storage for count elements
+    template <typename T>
+    T* allocateArray(size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>, "FrameArena never runs destructors");
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    size_t capacity() const;
+
+private:
+    struct Block {
+        std::unique_ptr<unsigned char[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t used = 0;    // bytes taken from blocks.back(), padding included
+
+    void addBlock(size_t size);
+};
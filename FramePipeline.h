@@ -0,0 +1,89 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Hands whole frames of state from a producer thread to a consumer thread
+// through a fixed set of slots. The producer fills a free slot while the
+// consumer works on an earlier one, so with two slots the stages overlap by
+// one frame; published slots are read in order. Either side blocks when it
+// gets too far ahead. stop() wakes both sides, which then get nullptr.
+// All bookkeeping is sized up front; passing a frame through doesn't allocate.
+template <typename T>
+class FramePipeline {
+public:
+    size_t producerWaits = 0;   // acquireWrite found every slot busy
+    size_t consumerWaits = 0;   // acquireRead found nothing published
+
+    explicit FramePipeline(size_t slotCount = 2) : slots(new T[slotCount]), ready(slotCount) {
+        freeSlots.reserve(slotCount);
+        for (size_t i = 0; i < slotCount; ++i)
+            freeSlots.push_back(&slots[i]);
+    }
+
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    // Producer side
+    T* acquireWrite() {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (freeSlots.empty() && !stopping)
+            ++producerWaits;
+        changed.wait(lock, [this] { return stopping || !freeSlots.empty(); });
+        if (stopping)
+            return nullptr;
+        T* slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+    }
+
+    void publish(T* slot) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready[(readyFirst + readyCount++) % ready.size()] = slot;
+        }
+        changed.notify_all();
+    }
+
+    // Consumer side
+    T* acquireRead() {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (readyCount == 0 && !stopping)
+            ++consumerWaits;
+        changed.wait(lock, [this] { return stopping || readyCount > 0; });
+        if (readyCount == 0)
+            return nullptr;
+        T* slot = ready[readyFirst];
+        readyFirst = (readyFirst + 1) % ready.size();
+        --readyCount;
+        return slot;
+    }
+
+    void release(T* slot) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            freeSlots.push_back(slot);
+        }
+        changed.notify_all();
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+    }
+
+private:
+    std::unique_ptr<T[]> slots;
+    std::vector<T*> freeSlots;
+    std::vector<T*> ready;      // ring of published slots, oldest at readyFirst
+    size_t readyFirst = 0;
+    size_t readyCount = 0;
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool stopping = false;
+};
@@ -0,0 +1,27 @@
+#include "FrameTimeStats.h"
+#include <algorithm>
+#include <cmath>
+
+FrameTimeSummary summarizeFrameTimes(std::vector<float> samplesMs) {
+    FrameTimeSummary s;
+    s.frames = samplesMs.size();
+    if (samplesMs.empty())
+        return s;
+
+    std::sort(samplesMs.begin(), samplesMs.end());
+    double sum = 0.0;
+    for (float ms : samplesMs)
+        sum += ms;
+
+    auto percentile = [&](float p) {
+        size_t rank = (size_t)std::ceil(p / 100.0f * samplesMs.size());
+        return samplesMs[std::clamp<size_t>(rank, 1, samplesMs.size()) - 1];
+    };
+    s.minMs = samplesMs.front();
+    s.maxMs = samplesMs.back();
+    s.meanMs = (float)(sum / samplesMs.size());
+    s.p50Ms = percentile(50.0f);
+    s.p95Ms = percentile(95.0f);
+    s.p99Ms = percentile(99.0f);
+    return s;
+}
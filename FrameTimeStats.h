@@ -0,0 +1,12 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+struct FrameTimeSummary {
+    size_t frames = 0;
+    float minMs = 0.0f, meanMs = 0.0f, maxMs = 0.0f;
+    float p50Ms = 0.0f, p95Ms = 0.0f, p99Ms = 0.0f;
+};
+
+// Nearest-rank percentiles over a run's frame times
+FrameTimeSummary summarizeFrameTimes(std::vector<float> samplesMs);
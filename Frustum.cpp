@@ -0,0 +1,33 @@
+#include "Frustum.h"
+
+void Frustum::extract(const glm::mat4& m) {
+    // glm is column-major: m[col][row]
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    planes[0] = row3 + row0; // left
+    planes[1] = row3 - row0; // right
+    planes[2] = row3 + row1; // bottom
+    planes[3] = row3 - row1; // top
+    planes[4] = row3 + row2; // near
+    planes[5] = row3 - row2; // far
+
+    for (glm::vec4& p : planes)
+        p /= glm::length(glm::vec3(p));
+}
+
+bool Frustum::intersectsAABB(const glm::vec3& boxMin, const glm::vec3& boxMax) const {
+    for (const glm::vec4& p : planes) {
+        // Test the box corner furthest along the plane normal
+        glm::vec3 v(
+            p.x >= 0.0f ? boxMax.x : boxMin.x,
+            p.y >= 0.0f ? boxMax.y : boxMin.y,
+            p.z >= 0.0f ? boxMax.z : boxMin.z
+        );
+        if (glm::dot(glm::vec3(p), v) + p.w < 0.0f)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <glm.hpp>
+
+// View frustum planes extracted from a view-projection matrix
+// (Gribb/Hartmann). Plane normals point inwards.
+class Frustum {
+public:
+    glm::vec4 planes[6];
+
+    Frustum() = default;
+    explicit Frustum(const glm::mat4& viewProj) { extract(viewProj); }
+
+    void extract(const glm::mat4& viewProj);
+    bool intersectsAABB(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+};
@@ -0,0 +1,65 @@
+#include "GLStateCache.h"
+
+void GLStateCache::useProgram(GLuint p) {
+    if (p == program) {
+        ++skipped;
+        return;
+    }
+    glUseProgram(p);
+    program = p;
+    ++issued;
+}
+
+void GLStateCache::bindVertexArray(GLuint v) {
+    if (v == vao) {
+        ++skipped;
+        return;
+    }
+    glBindVertexArray(v);
+    vao = v;
+    ++issued;
+}
+
+void GLStateCache::bindTexture(int unit, GLenum target, GLuint texture) {
+    TextureBinding& b = textures[unit];
+    if (b.target == target && b.texture == texture) {
+        ++skipped;
+        return;
+    }
+    if (unit != activeUnit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeUnit = unit;
+        ++issued;
+    }
+    glBindTexture(target, texture);
+    b.target = target;
+    b.texture = texture;
+    ++issued;
+}
+
+void GLStateCache::setDepthTest(bool enabled) {
+    if (depthTest == (int)enabled) {
+        ++skipped;
+        return;
+    }
+    if (enabled)
+        glEnable(GL_DEPTH_TEST);
+    else
+        glDisable(GL_DEPTH_TEST);
+    depthTest = (int)enabled;
+    ++issued;
+}
+
+void GLStateCache::invalidate() {
+    program = UNKNOWN;
+    vao = UNKNOWN;
+    activeUnit = -1;
+    for (TextureBinding& b : textures)
+        b = TextureBinding();
+    depthTest = -1;
+}
+
+void GLStateCache::resetStats() {
+    issued = 0;
+    skipped = 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <glad/gl.h>
+#include <cstddef>
+
+// Shadow copy of the GL binding state the render loop touches. Every setter
+// compares against the last value it issued and skips the call if nothing
+// would change. State starts out unknown, so the first call of each kind is
+// always issued; call invalidate() after code that binds behind its back.
+class GLStateCache {
+public:
+    static const int MAX_TEXTURE_UNITS = 8;
+
+    // Stats since the last resetStats()
+    size_t issued = 0;
+    size_t skipped = 0;
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vao);
+    void bindTexture(int unit, GLenum target, GLuint texture);
+    void setDepthTest(bool enabled);
+
+    void invalidate();
+    void resetStats();
+
+private:
+    static const GLuint UNKNOWN = 0xFFFFFFFFu;
+
+    struct TextureBinding {
+        GLenum target = 0;
+        GLuint texture = UNKNOWN;
+    };
+
+    GLuint program = UNKNOWN;
+    GLuint vao = UNKNOWN;
+    int activeUnit = -1;
+    TextureBinding textures[MAX_TEXTURE_UNITS];
+    int depthTest = -1;
+};
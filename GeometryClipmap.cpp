@@ -0,0 +1,119 @@
+#include "GeometryClipmap.h"
+#include <algorithm>
+#include <cmath>
+
+GeometryClipmap::GeometryClipmap(HeightSampler sampler, float spacing, int levelCount, int ringSize, size_t uploadBudgetBytes)
+    : levelCount(levelCount), ringSize(ringSize), gridQuads(ringSize - 2), spacing(spacing),
+    uploadBudgetBytes(uploadBudgetBytes), levels(levelCount), sampler(std::move(sampler)) {
+}
+
+void GeometryClipmap::queueRegion(int level, int x0, int z0, int w, int h) {
+    // The rectangle is contiguous in level samples but may wrap in the
+    // toroidal texture, so split it into up to four texture rectangles.
+    const int step = 1 << level;
+    int z = z0;
+    while (z < z0 + h) {
+        int tz = wrap(z, ringSize);
+        int rows = std::min(z0 + h - z, ringSize - tz);
+        int x = x0;
+        while (x < x0 + w) {
+            int tx = wrap(x, ringSize);
+            int cols = std::min(x0 + w - x, ringSize - tx);
+
+            ClipmapUpload up{ level, tx, tz, cols, rows, staging.size() };
+            for (int r = 0; r < rows; ++r)
+                for (int c = 0; c < cols; ++c)
+                    staging.push_back(sampler((x + c) * step, (z + r) * step));
+            pendingUploads.push_back(up);
+
+            x += cols;
+        }
+        z += rows;
+    }
+}
+
+// Moves a level's window towards its target by up to (dx, dz) samples,
+// limited by the remaining budget, keeping the resident window valid
+// throughout. The exposed columns are only sampled for the rows that stay
+// resident, so a diagonal move uploads the corner once, with the rows.
+void GeometryClipmap::scrollLevel(int level, int dx, int dz) {
+    ClipmapLevel& l = levels[level];
+    const size_t stripBytes = size_t(ringSize) * sizeof(float);
+    int nx = (int)std::min<size_t>(std::abs(dx), budgetLeft / stripBytes);
+    int nz = (int)std::min<size_t>(std::abs(dz), budgetLeft / stripBytes - nx);
+    if (nx == 0 && nz == 0)
+        return;
+
+    int newX = l.originX + (dx > 0 ? nx : -nx);
+    int newZ = l.originZ + (dz > 0 ? nz : -nz);
+    if (nx > 0) {
+        int x0 = dx > 0 ? l.originX + ringSize : newX;
+        queueRegion(level, x0, std::max(l.originZ, newZ), nx, ringSize - nz);
+    }
+    if (nz > 0) {
+        int z0 = dz > 0 ? l.originZ + ringSize : newZ;
+        queueRegion(level, newX, z0, ringSize, nz);
+    }
+    l.originX = newX;
+    l.originZ = newZ;
+    budgetLeft -= (size_t(nx) * (ringSize - nz) + size_t(nz) * ringSize) * sizeof(float);
+}
+
+void GeometryClipmap::update(const glm::vec3& cameraPos) {
+    pendingUploads.clear();
+    staging.clear();
+    budgetLeft = uploadBudgetBytes;
+
+    const float camX = cameraPos.x / spacing;
+    const float camZ = cameraPos.z / spacing;
+    const size_t stripBytes = size_t(ringSize) * sizeof(float);
+
+    // Coarse levels first: they change least often and everything finer
+    // depends on them being active.
+    bool coarserActive = true;
+    for (int level = levelCount - 1; level >= 0; --level) {
+        ClipmapLevel& l = levels[level];
+        const float scale = float(1 << level);
+
+        // Even origins keep every level's samples on its parent's lattice
+        l.targetX = 2 * (int)std::floor(camX / scale * 0.5f) - ringSize / 2;
+        l.targetZ = 2 * (int)std::floor(camZ / scale * 0.5f) - ringSize / 2;
+
+        int dx = l.targetX - l.originX;
+        int dz = l.targetZ - l.originZ;
+        if (!l.valid || std::abs(dx) >= ringSize || std::abs(dz) >= ringSize) {
+            // Nothing resident is reusable: refill the whole window column by
+            // column, restarting if the target moves before we finish.
+            if (l.valid || dx != 0 || dz != 0) {
+                l.valid = false;
+                l.originX = l.targetX;
+                l.originZ = l.targetZ;
+                l.filledColumns = 0;
+            }
+            int cols = (int)std::min<size_t>(ringSize - l.filledColumns, budgetLeft / stripBytes);
+            if (cols > 0) {
+                queueRegion(level, l.originX + l.filledColumns, l.originZ, cols, ringSize);
+                l.filledColumns += cols;
+                budgetLeft -= cols * stripBytes;
+            }
+            l.valid = l.filledColumns == ringSize;
+        }
+        else {
+            // Toroidal scroll: only the newly exposed L-shaped strips
+            scrollLevel(level, dx, dz);
+        }
+
+        l.active = coarserActive && l.valid && l.originX == l.targetX && l.originZ == l.targetZ;
+        coarserActive = l.active;
+    }
+
+    lastUploadBytes = uploadBudgetBytes - budgetLeft;
+    peakUploadBytes = std::max(peakUploadBytes, lastUploadBytes);
+}
+
+int GeometryClipmap::finestActiveLevel() const {
+    int finest = levelCount;
+    for (int level = levelCount - 1; level >= 0 && levels[level].active; --level)
+        finest = level;
+    return finest;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <glm.hpp>
+#include <functional>
+#include <vector>
+
+// One rectangle of samples to copy into a level's toroidal height texture.
+// Data lives in GeometryClipmap::staging at dataOffset, row-major w x h.
+struct ClipmapUpload {
+    int level;
+    int texX, texZ;
+    int w, h;
+    size_t dataOffset;
+};
+
+struct ClipmapLevel {
+    int originX = 0, originZ = 0;   // first resident sample, in level samples
+    int targetX = 0, targetZ = 0;   // where the camera wants the origin to be
+    bool valid = false;             // texture holds data for origin
+    int filledColumns = 0;          // progress of a full refill while !valid
+    bool active = false;            // valid, at target and nested in an active coarser level
+};
+
+// CPU side of geometry clipmaps (Losasso & Hoppe 2004). Each level is a
+// ringSize x ringSize window of height samples, spaced 2^level cells apart
+// and centered on the camera. Windows are stored toroidally: when the camera
+// moves, only the newly exposed L-shaped strips are resampled. Total upload
+// per update() is capped at uploadBudgetBytes; levels that cannot catch up in
+// time are deactivated (coarser levels fill in) until they do.
+//
+// No GL calls are made here; ClipmapRenderer consumes pendingUploads.
+class GeometryClipmap {
+public:
+    using HeightSampler = std::function<float(int x, int z)>;
+
+    int levelCount;
+    int ringSize;           // texture size per level, power of two
+    int gridQuads;          // quads per rendered level edge (ringSize - 2)
+    float spacing;
+    size_t uploadBudgetBytes;
+
+    std::vector<ClipmapLevel> levels;
+    std::vector<ClipmapUpload> pendingUploads;
+    std::vector<float> staging;
+
+    // Stats
+    size_t lastUploadBytes = 0;
+    size_t peakUploadBytes = 0;
+
+    GeometryClipmap(HeightSampler sampler, float spacing, int levelCount = 5, int ringSize = 128,
+        size_t uploadBudgetBytes = 128 * 1024);
+
+    // Recenter all levels on the camera and queue the uploads this needs.
+    void update(const glm::vec3& cameraPos);
+
+    int finestActiveLevel() const;  // levelCount if none are active
+    static int wrap(int v, int n) { int r = v % n; return r < 0 ? r + n : r; }
+
+private:
+    HeightSampler sampler;
+    size_t budgetLeft = 0;
+
+    void scrollLevel(int level, int dx, int dz);
+    void queueRegion(int level, int x0, int z0, int w, int h);
+};
@@ -0,0 +1,104 @@
+#include "HeadlessContext.h"
+#include <iostream>
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+bool HeadlessContext::create() {
+    EGLDisplay dpy = EGL_NO_DISPLAY;
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay)
+        dpy = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (dpy == EGL_NO_DISPLAY)
+        dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, &major, &minor)) {
+        std::cerr << "Failed to initialize EGL\n";
+        return false;
+    }
+    display = dpy;
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "EGL has no desktop OpenGL support\n";
+        destroy();
+        return false;
+    }
+
+    // EGL_SURFACE_TYPE defaults to EGL_WINDOW_BIT, which surfaceless displays never offer
+    const EGLint configAttribs[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(dpy, configAttribs, &config, 1, &numConfigs) || numConfigs == 0) {
+        std::cerr << "No EGL config for desktop OpenGL\n";
+        destroy();
+        return false;
+    }
+
+    static const int versions[][2] = { { 4, 6 }, { 4, 5 }, { 4, 3 }, { 4, 1 }, { 3, 3 } };
+    EGLContext ctx = EGL_NO_CONTEXT;
+    for (const auto& v : versions) {
+        const EGLint contextAttribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, v[0],
+            EGL_CONTEXT_MINOR_VERSION, v[1],
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        ctx = eglCreateContext(dpy, config, EGL_NO_CONTEXT, contextAttribs);
+        if (ctx != EGL_NO_CONTEXT)
+            break;
+    }
+    if (ctx == EGL_NO_CONTEXT) {
+        std::cerr << "Failed to create an OpenGL 3.3+ core context\n";
+        destroy();
+        return false;
+    }
+    context = ctx;
+
+    // Rendering goes to an FBO, so no surface is needed unless the driver
+    // lacks EGL_KHR_surfaceless_context
+    if (!eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx)) {
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        EGLSurface pbuffer = eglCreatePbufferSurface(dpy, config, pbufferAttribs);
+        if (pbuffer == EGL_NO_SURFACE || !eglMakeCurrent(dpy, pbuffer, pbuffer, ctx)) {
+            std::cerr << "Failed to make the headless context current\n";
+            destroy();
+            return false;
+        }
+        surface = pbuffer;
+    }
+    return true;
+}
+
+void HeadlessContext::destroy() {
+    if (!display)
+        return;
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (surface)
+        eglDestroySurface(display, surface);
+    if (context)
+        eglDestroyContext(display, context);
+    eglTerminate(display);
+    display = context = surface = nullptr;
+}
+
+GLADapiproc HeadlessContext::getProcAddress(const char* name) {
+    return (GLADapiproc)eglGetProcAddress(name);
+}
+
+#else
+
+bool HeadlessContext::create() {
+    std::cerr << "Headless mode needs EGL and is only available on Linux\n";
+    return false;
+}
+
+void HeadlessContext::destroy() {
+}
+
+GLADapiproc HeadlessContext::getProcAddress(const char*) {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,21 @@
+#pragma once
+#include <glad/gl.h>
+
+// GL context with no window and no display server, for benchmark and CI
+// runs. Uses EGL on Mesa's surfaceless platform (llvmpipe on CPU-only
+// machines), falling back to the default EGL display. Only built on Linux;
+// elsewhere create() reports that headless mode is unavailable.
+class HeadlessContext {
+public:
+    // Tries the highest core profile version first, down to 3.3
+    bool create();
+    void destroy();
+
+    // Loader for gladLoadGL
+    static GLADapiproc getProcAddress(const char* name);
+
+private:
+    void* display = nullptr;
+    void* context = nullptr;
+    void* surface = nullptr;
+};
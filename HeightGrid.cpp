@@ -0,0 +1,10 @@
+#include "HeightGrid.h"
+
+HeightGrid::HeightGrid(const std::vector<std::vector<float>>& heightMap, float spacing)
+    : spacing(spacing) {
+    h = (int)heightMap.size();
+    w = h > 0 ? (int)heightMap[0].size() : 0;
+    heights.reserve(size_t(w) * h);
+    for (const std::vector<float>& row : heightMap)
+        heights.insert(heights.end(), row.begin(), row.end());
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+
+// Heightmap samples in one row-major array with world-space spacing, for
+// queries that run per body per tick. Sample (x, z) sits at world
+// (x * spacing, z * spacing). Queries outside the grid clamp to its edge;
+// sampling needs at least 2x2 samples.
+class HeightGrid {
+public:
+    int w = 0, h = 0;
+    float spacing = 1.0f;
+    std::vector<float> heights;     // w * h
+
+    HeightGrid() = default;
+    HeightGrid(const std::vector<std::vector<float>>& heightMap, float spacing);
+
+    float at(int x, int z) const { return heights[z * w + x]; }
+
+    // Bilinear height at world (x, z). Inline, so per-body loops and
+    // templated samplers can fold it into their own code.
+    float sample(float x, float z) const {
+        float fx = std::clamp(x / spacing, 0.0f, float(w - 1));
+        float fz = std::clamp(z / spacing, 0.0f, float(h - 1));
+        int x0 = std::min((int)fx, w - 2);
+        int z0 = std::min((int)fz, h - 2);
+        float tx = fx - x0, tz = fz - z0;
+
+        const float* row0 = heights.data() + size_t(z0) * w + x0;
+        const float* row1 = row0 + w;
+        float hx0 = row0[0] + (row0[1] - row0[0]) * tx;
+        float hx1 = row1[0] + (row1[1] - row1[0]) * tx;
+        return hx0 + (hx1 - hx0) * tz;
+    }
+
+    float extentX() const { return (w - 1) * spacing; }
+    float extentZ() const { return (h - 1) * spacing; }
+};
@@ -0,0 +1,23 @@
+#include "HeightTexture.h"
+
+GLuint createHeightTexture(const std::vector<std::vector<float>>& heightMap) {
+    int h = (int)heightMap.size();
+    int w = h > 0 ? (int)heightMap[0].size() : 0;
+
+    std::vector<float> texels;
+    texels.reserve(w * h);
+    for (const auto& row : heightMap)
+        texels.insert(texels.end(), row.begin(), row.end());
+
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, w, h, 0, GL_RED, GL_FLOAT, texels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return tex;
+}
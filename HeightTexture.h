@@ -0,0 +1,7 @@
+#pragma once
+#include <glad/gl.h>
+#include <vector>
+
+// Uploads the heightmap as a single-channel float texture with linear
+// filtering and edge clamping, for vertex texture fetch.
+GLuint createHeightTexture(const std::vector<std::vector<float>>& heightMap);
@@ -0,0 +1,87 @@
+#include "HeightfieldMinMax.h"
+#include <algorithm>
+
+HeightfieldMinMax::HeightfieldMinMax(const std::vector<std::vector<float>>& heightMap) {
+    build(heightMap);
+}
+
+void HeightfieldMinMax::build(const std::vector<std::vector<float>>& heightMap) {
+    levels.clear();
+    cellsH = (int)heightMap.size() - 1;
+    cellsW = cellsH > 0 ? (int)heightMap[0].size() - 1 : 0;
+    if (cellsW <= 0 || cellsH <= 0)
+        return;
+
+    MinMaxLevel base;
+    base.w = cellsW;
+    base.h = cellsH;
+    base.minH.resize(base.w * base.h);
+    base.maxH.resize(base.w * base.h);
+    for (int z = 0; z < cellsH; ++z) {
+        for (int x = 0; x < cellsW; ++x) {
+            float h00 = heightMap[z][x], h10 = heightMap[z][x + 1];
+            float h01 = heightMap[z + 1][x], h11 = heightMap[z + 1][x + 1];
+            base.minH[z * base.w + x] = std::min(std::min(h00, h10), std::min(h01, h11));
+            base.maxH[z * base.w + x] = std::max(std::max(h00, h10), std::max(h01, h11));
+        }
+    }
+    levels.push_back(std::move(base));
+
+    while (levels.back().w > 1 || levels.back().h > 1) {
+        const MinMaxLevel& prev = levels.back();
+        MinMaxLevel next;
+        next.w = (prev.w + 1) / 2;
+        next.h = (prev.h + 1) / 2;
+        next.minH.resize(next.w * next.h);
+        next.maxH.resize(next.w * next.h);
+        for (int z = 0; z < next.h; ++z) {
+            for (int x = 0; x < next.w; ++x) {
+                int px0 = x * 2, pz0 = z * 2;
+                int px1 = std::min(px0 + 1, prev.w - 1);
+                int pz1 = std::min(pz0 + 1, prev.h - 1);
+                float mn = prev.minH[pz0 * prev.w + px0];
+                float mx = prev.maxH[pz0 * prev.w + px0];
+                mn = std::min(mn, prev.minH[pz0 * prev.w + px1]);
+                mx = std::max(mx, prev.maxH[pz0 * prev.w + px1]);
+                mn = std::min(mn, prev.minH[pz1 * prev.w + px0]);
+                mx = std::max(mx, prev.maxH[pz1 * prev.w + px0]);
+                mn = std::min(mn, prev.minH[pz1 * prev.w + px1]);
+                mx = std::max(mx, prev.maxH[pz1 * prev.w + px1]);
+                next.minH[z * next.w + x] = mn;
+                next.maxH[z * next.w + x] = mx;
+            }
+        }
+        levels.push_back(std::move(next));
+    }
+}
+
+bool HeightfieldMinMax::rangeMinMax(int x0, int z0, int x1, int z1, float& minH, float& maxH) const {
+    x0 = std::max(x0, 0);
+    z0 = std::max(z0, 0);
+    x1 = std::min(x1, cellsW);
+    z1 = std::min(z1, cellsH);
+    if (levels.empty() || x0 >= x1 || z0 >= z1)
+        return false;
+
+    // Pick the coarsest level where the rectangle spans at most two texels per
+    // axis, which keeps the lookup O(1) while staying conservative.
+    int extent = std::max(x1 - x0, z1 - z0);
+    int level = 0;
+    while (level + 1 < (int)levels.size() && (1 << (level + 1)) < extent)
+        ++level;
+
+    const MinMaxLevel& l = levels[level];
+    int tx0 = x0 >> level, tz0 = z0 >> level;
+    int tx1 = std::min((x1 - 1) >> level, l.w - 1);
+    int tz1 = std::min((z1 - 1) >> level, l.h - 1);
+
+    minH = l.minH[tz0 * l.w + tx0];
+    maxH = l.maxH[tz0 * l.w + tx0];
+    for (int z = tz0; z <= tz1; ++z) {
+        for (int x = tx0; x <= tx1; ++x) {
+            minH = std::min(minH, l.minH[z * l.w + x]);
+            maxH = std::max(maxH, l.maxH[z * l.w + x]);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+
+// Min/max height pyramid over the cells of a heightmap. Level 0 stores the
+// min/max of each cell's four corner samples, every level above it reduces
+// 2x2 texels of the level below. Used for conservative terrain bounds.
+struct MinMaxLevel {
+    int w = 0, h = 0;
+    std::vector<float> minH;
+    std::vector<float> maxH;
+};
+
+class HeightfieldMinMax {
+public:
+    std::vector<MinMaxLevel> levels;
+    int cellsW = 0, cellsH = 0;
+
+    HeightfieldMinMax() = default;
+    explicit HeightfieldMinMax(const std::vector<std::vector<float>>& heightMap);
+
+    void build(const std::vector<std::vector<float>>& heightMap);
+
+    // Conservative min/max over the cell rectangle [x0, x1) x [z0, z1),
+    // clipped to the heightmap. Returns false if the rectangle is empty.
+    bool rangeMinMax(int x0, int z0, int x1, int z1, float& minH, float& maxH) const;
+};
@@ -0,0 +1,106 @@
+#include "ImageWriter.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+bool writePPM(const std::string& path, int width, int height, const std::vector<unsigned char>& rgb) {
+    std::ofstream out(path, std::ios::binary);
+    out << "P6\n" << width << " " << height << "\n255\n";
+    out.write((const char*)rgb.data(), rgb.size());
+    if (!out) {
+        std::cerr << "Failed to write " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+namespace {
+
+uint32_t crc32(const unsigned char* data, size_t len, uint32_t crc = 0) {
+    static uint32_t table[256];
+    static bool init = false;
+    if (!init) {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        init = true;
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+void putU32(std::vector<unsigned char>& v, uint32_t x) {
+    v.push_back((unsigned char)(x >> 24));
+    v.push_back((unsigned char)(x >> 16));
+    v.push_back((unsigned char)(x >> 8));
+    v.push_back((unsigned char)x);
+}
+
+void writeChunk(std::ofstream& out, const char* type, const std::vector<unsigned char>& payload) {
+    std::vector<unsigned char> chunk;
+    putU32(chunk, (uint32_t)payload.size());
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), payload.begin(), payload.end());
+    putU32(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+    out.write((const char*)chunk.data(), chunk.size());
+}
+
+}
+
+bool writePNG(const std::string& path, int width, int height, const std::vector<unsigned char>& rgb) {
+    std::ofstream out(path, std::ios::binary);
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    out.write((const char*)signature, 8);
+
+    std::vector<unsigned char> ihdr;
+    putU32(ihdr, (uint32_t)width);
+    putU32(ihdr, (uint32_t)height);
+    ihdr.insert(ihdr.end(), { 8, 2, 0, 0, 0 });     // 8-bit RGB, no interlace
+    writeChunk(out, "IHDR", ihdr);
+
+    // Filter type 0 in front of every row
+    const size_t row = size_t(width) * 3;
+    std::vector<unsigned char> raw;
+    raw.reserve((row + 1) * height);
+    for (int y = 0; y < height; ++y) {
+        raw.push_back(0);
+        raw.insert(raw.end(), rgb.begin() + y * row, rgb.begin() + (y + 1) * row);
+    }
+
+    // zlib stream of stored deflate blocks
+    std::vector<unsigned char> idat = { 0x78, 0x01 };
+    uint32_t a = 1, b = 0;
+    for (size_t pos = 0; pos < raw.size() || raw.empty();) {
+        size_t len = std::min<size_t>(raw.size() - pos, 65535);
+        bool last = pos + len == raw.size();
+        idat.push_back(last ? 1 : 0);
+        idat.push_back((unsigned char)len);
+        idat.push_back((unsigned char)(len >> 8));
+        idat.push_back((unsigned char)~len);
+        idat.push_back((unsigned char)(~len >> 8));
+        for (size_t i = 0; i < len; ++i) {
+            unsigned char c = raw[pos + i];
+            idat.push_back(c);
+            a = (a + c) % 65521;
+            b = (b + a) % 65521;
+        }
+        pos += len;
+        if (last)
+            break;
+    }
+    putU32(idat, (b << 16) | a);
+    writeChunk(out, "IDAT", idat);
+    writeChunk(out, "IEND", {});
+
+    if (!out) {
+        std::cerr << "Failed to write " << path << "\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Writers for 8-bit RGB frame dumps, top row first. PNG output uses
+// uncompressed deflate blocks: no zlib dependency, and the pixels round-trip
+// exactly for image comparisons.
+bool writePPM(const std::string& path, int width, int height, const std::vector<unsigned char>& rgb);
+bool writePNG(const std::string& path, int width, int height, const std::vector<unsigned char>& rgb);
@@ -0,0 +1,16 @@
+#include "IndirectCommands.h"
+
+void buildIndirectCommands(const std::vector<TerrainChunk>& chunks, const std::vector<int>& visible,
+                           const std::vector<char>& resident, std::vector<DrawElementsIndirectCommand>& commands,
+                           IndirectStats& stats) {
+    commands.clear();
+    stats = IndirectStats();
+    for (int i : visible) {
+        const TerrainChunk& c = chunks[i];
+        if (!resident[i] || c.indexCount == 0)
+            continue;
+        commands.push_back({ c.indexCount, 1, c.firstIndex, c.baseVertex, 0 });
+        stats.triangles += c.indexCount / 3;
+    }
+    stats.commands = commands.size();
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "TerrainChunks.h"
+#include <cstdint>
+#include <vector>
+
+// Layout of one glMultiDrawElementsIndirect record
+struct DrawElementsIndirectCommand {
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+};
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "indirect command must be tightly packed");
+
+struct IndirectStats {
+    size_t commands = 0;
+    size_t triangles = 0;
+};
+
+// One command per visible chunk whose mesh is resident. Chunks with nothing
+// uploaded yet are skipped, so the result can be submitted as-is.
+void buildIndirectCommands(const std::vector<TerrainChunk>& chunks, const std::vector<int>& visible,
+                           const std::vector<char>& resident, std::vector<DrawElementsIndirectCommand>& commands,
+                           IndirectStats& stats);
@@ -0,0 +1,225 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <string>
+
+namespace {
+// Index of this thread's deque, or -1 off the worker threads
+thread_local int workerIndex = -1;
+}
+
+WorkStealingDeque::WorkStealingDeque(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity)
+        size *= 2;
+    buffer.reset(new std::atomic<Job*>[size]);
+    mask = (int64_t)size - 1;
+}
+
+bool WorkStealingDeque::push(Job* job) {
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    if (b - t > mask)
+        return false;
+    buffer[b & mask].store(job, std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_release);
+    return true;
+}
+
+Job* WorkStealingDeque::pop() {
+    // The bottom store and top load must not reorder against a thief's top
+    // load and bottom load, hence seq_cst on all four
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_seq_cst);
+    if (t > b) {
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    Job* job = buffer[b & mask].load(std::memory_order_relaxed);
+    if (t == b) {
+        // Last item: race the thieves for it
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            job = nullptr;
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job* WorkStealingDeque::steal() {
+    int64_t t = top.load(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_seq_cst);
+    if (t >= b)
+        return nullptr;
+    Job* job = buffer[t & mask].load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+    return job;
+}
+
+JobSystem& JobSystem::instance() {
+    static JobSystem system;
+    return system;
+}
+
+JobSystem::~JobSystem() {
+    stop();
+    Job* job;
+    while (freeJobs.pop(job))
+        delete job;
+}
+
+void JobSystem::start(unsigned threadCount) {
+    if (!workers.empty())
+        return;
+    if (threadCount == 0)
+        threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    stopping = false;
+    for (unsigned i = 0; i < threadCount; ++i)
+        deques.push_back(std::make_unique<WorkStealingDeque>());
+    for (unsigned i = 0; i < threadCount; ++i)
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+void JobSystem::stop() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& t : workers)
+        t.join();
+    workers.clear();
+
+    // Anything still queued runs here rather than being dropped
+    while (Job* job = findWork())
+        execute(job);
+    deques.clear();
+}
+
+Job* JobSystem::allocate(std::function<void()>&& work, JobCounter* counter) {
+    Job* job;
+    if (!freeJobs.pop(job))
+        job = new Job;
+    job->work = std::move(work);
+    job->counter = counter;
+    return job;
+}
+
+void JobSystem::run(std::function<void()> work, JobCounter* counter) {
+    if (counter)
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+    submit(allocate(std::move(work), counter));
+}
+
+void JobSystem::runAfter(JobCounter& dependency, std::function<void()> work, JobCounter* counter) {
+    if (counter)
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+    Job* job = allocate(std::move(work), counter);
+    {
+        // Checked under the lock finish() takes after reaching zero, so the
+        // job is either queued here and released there, or submitted now
+        std::lock_guard<std::mutex> lock(dependency.continuationMutex);
+        if (dependency.pending.load() != 0) {
+            dependency.continuations.push_back(job);
+            return;
+        }
+    }
+    submit(job);
+}
+
+void JobSystem::submit(Job* job) {
+    bool queued = workerIndex >= 0 && workerIndex < (int)deques.size() && deques[workerIndex]->push(job);
+    if (!queued)
+        queued = injected.push(job);
+    if (!queued) {
+        // Every queue is full: run it here
+        execute(job);
+        return;
+    }
+
+    // seq_cst on both sides: a worker going to sleep either sees the new
+    // epoch or is counted in sleeping here
+    workEpoch.fetch_add(1);
+    if (sleeping.load() > 0) {
+        { std::lock_guard<std::mutex> lock(sleepMutex); }
+        wake.notify_one();
+    }
+}
+
+Job* JobSystem::findWork() {
+    Job* job = nullptr;
+    if (workerIndex >= 0 && workerIndex < (int)deques.size() && (job = deques[workerIndex]->pop()))
+        return job;
+    if (injected.pop(job))
+        return job;
+
+    // Steal, starting after our own deque so thieves spread out
+    const size_t n = deques.size();
+    for (size_t i = 1; i <= n; ++i) {
+        size_t victim = (size_t(workerIndex + 1) + i) % n;
+        if ((int)victim == workerIndex)
+            continue;
+        if ((job = deques[victim]->steal())) {
+            steals.fetch_add(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::execute(Job* job) {
+    job->work();
+    jobsExecuted.fetch_add(1, std::memory_order_relaxed);
+    JobCounter* counter = job->counter;
+
+    job->work = nullptr;
+    if (!freeJobs.push(job))
+        delete job;
+
+    if (counter)
+        finish(*counter);
+}
+
+void JobSystem::finish(JobCounter& counter) {
+    counter.finishing.fetch_add(1);
+    if (counter.pending.fetch_sub(1) == 1) {
+        std::vector<Job*> ready;
+        {
+            std::lock_guard<std::mutex> lock(counter.continuationMutex);
+            ready.swap(counter.continuations);
+        }
+        for (Job* job : ready)
+            submit(job);
+    }
+    // Last touch: once this lands the counter may be destroyed
+    counter.finishing.fetch_sub(1);
+}
+
+void JobSystem::wait(JobCounter& counter) {
+    while (!counter.done()) {
+        if (Job* job = findWork())
+            execute(job);
+        else
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::workerLoop(unsigned index) {
+    workerIndex = (int)index;
+    Profiler::instance().setThreadName(("Job worker " + std::to_string(index + 1)).c_str());
+    for (;;) {
+        uint64_t epoch = workEpoch.load(std::memory_order_acquire);
+        if (Job* job = findWork()) {
+            execute(job);
+            continue;
+        }
+
+        // Nothing anywhere: sleep until something is submitted
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleeping.fetch_add(1);
+        wake.wait(lock, [&] { return stopping || workEpoch.load() != epoch; });
+        sleeping.fetch_sub(1);
+        if (stopping)
+            return;
+    }
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include "LockFreeQueue.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+struct Job;
+
+// Counts unfinished jobs. Jobs started with a counter increment it and
+// decrement it when they finish; JobSystem::wait blocks on it reaching zero
+// and runAfter queues work behind it.
+class JobCounter {
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    // Also false while the last job is still releasing continuations, so a
+    // counter that reads done can be destroyed
+    bool done() const { return pending.load() == 0 && finishing.load() == 0; }
+
+private:
+    friend class JobSystem;
+    std::atomic<int> pending{ 0 };
+    std::atomic<int> finishing{ 0 };    // threads inside JobSystem::finish
+    std::mutex continuationMutex;
+    std::vector<Job*> continuations;    // released when pending reaches zero
+};
+
+struct Job {
+    std::function<void()> work;
+    JobCounter* counter = nullptr;
+};
+
+// Chase-Lev work-stealing deque (the sequentially consistent variant). The owning
+// worker pushes and pops at the bottom; other threads steal from the top.
+// Fixed capacity: push fails when full and the caller puts the job elsewhere.
+class WorkStealingDeque {
+public:
+    explicit WorkStealingDeque(size_t capacity = 4096);
+
+    bool push(Job* job);    // owner only
+    Job* pop();             // owner only
+    Job* steal();           // any thread
+
+private:
+    std::unique_ptr<std::atomic<Job*>[]> buffer;
+    int64_t mask;
+    alignas(64) std::atomic<int64_t> top{ 0 };
+    alignas(64) std::atomic<int64_t> bottom{ 0 };
+};
+
+// Engine-wide job system: one worker per spare core, each with its own
+// deque; idle workers steal. Threads that aren't workers (main, simulation)
+// submit through a shared queue. wait() runs jobs while it waits, so a
+// thread blocked on its own jobs helps finish them, and jobs still complete
+// with zero workers.
+class JobSystem {
+public:
+    std::atomic<size_t> jobsExecuted{ 0 };
+    std::atomic<size_t> steals{ 0 };
+
+    static JobSystem& instance();
+
+    // threadCount 0: hardware concurrency - 1, at least 1
+    void start(unsigned threadCount = 0);
+    void stop();
+    size_t workerCount() const { return workers.size(); }
+
+    void run(std::function<void()> work, JobCounter* counter = nullptr);
+    // Queued once dependency reaches zero (at once if it already has)
+    void runAfter(JobCounter& dependency, std::function<void()> work, JobCounter* counter = nullptr);
+    void wait(JobCounter& counter);
+
+    // body(begin, end) over [begin, end) in grain-sized pieces; returns when
+    // all of them have run
+    template <typename F>
+    void parallelFor(size_t begin, size_t end, size_t grain, F&& body) {
+        if (begin >= end)
+            return;
+        grain = std::max<size_t>(1, grain);
+        if (end - begin <= grain) {
+            body(begin, end);
+            return;
+        }
+        // Each job captures two words, which std::function holds inline, so
+        // a parallelFor in the frame loop doesn't allocate
+        struct Range {
+            std::remove_reference_t<F>* body;
+            size_t end, grain;
+        } range{ &body, end, grain };
+        const Range* r = &range;
+        JobCounter counter;
+        for (size_t i = begin; i < end; i += grain)
+            run([r, i] { (*r->body)(i, std::min(r->end, i + r->grain)); }, &counter);
+        wait(counter);
+    }
+
+private:
+    JobSystem() = default;
+    ~JobSystem();
+
+    void submit(Job* job);
+    Job* findWork();
+    void execute(Job* job);
+    void finish(JobCounter& counter);
+    Job* allocate(std::function<void()>&& work, JobCounter* counter);
+    void workerLoop(unsigned index);
+
+    std::vector<std::unique_ptr<WorkStealingDeque>> deques;
+    std::vector<std::thread> workers;
+    LockFreeQueue<Job*> injected{ 4096 };   // from non-worker threads
+    LockFreeQueue<Job*> freeJobs{ 4096 };   // recycled Job objects
+
+    std::atomic<uint64_t> workEpoch{ 0 };   // bumped on every submit, for sleeping workers
+    std::atomic<int> sleeping{ 0 };
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<bool> stopping{ false };
+};
@@ -0,0 +1,35 @@
+#include "MultiDrawSubmitter.h"
+#include <cstring>
+
+void MultiDrawSubmitter::init() {
+    indirect = GLAD_GL_VERSION_4_3 || GLAD_GL_ARB_multi_draw_indirect;
+}
+
+void MultiDrawSubmitter::submit(const std::vector<DrawElementsIndirectCommand>& commands, StreamBuffer& stream) {
+    if (commands.empty())
+        return;
+
+    if (indirect) {
+        const size_t bytes = commands.size() * sizeof(DrawElementsIndirectCommand);
+        size_t offset = 0;
+        if (void* dst = stream.map(bytes, 4, offset)) {
+            std::memcpy(dst, commands.data(), bytes);
+            stream.unmap();
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, stream.buffer);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)offset, (GLsizei)commands.size(), 0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+            return;
+        }
+    }
+
+    counts.clear();
+    offsets.clear();
+    baseVertices.clear();
+    for (const DrawElementsIndirectCommand& c : commands) {
+        counts.push_back((GLsizei)c.count);
+        offsets.push_back((const void*)(size_t(c.firstIndex) * sizeof(unsigned int)));
+        baseVertices.push_back(c.baseVertex);
+    }
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT, offsets.data(),
+        (GLsizei)commands.size(), baseVertices.data());
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "IndirectCommands.h"
+#include "StreamBuffer.h"
+#include <glad/gl.h>
+#include <vector>
+
+// Submits a list of indirect commands with a single draw call. With GL 4.3
+// or ARB_multi_draw_indirect the commands are written to the streaming ring
+// and drawn with glMultiDrawElementsIndirect; otherwise they are unpacked
+// into glMultiDrawElementsBaseVertex arrays. Expects the VAO to be bound.
+class MultiDrawSubmitter {
+public:
+    bool indirect = false;
+
+    void init();
+    void submit(const std::vector<DrawElementsIndirectCommand>& commands, StreamBuffer& stream);
+
+private:
+    std::vector<GLsizei> counts;
+    std::vector<const void*> offsets;
+    std::vector<GLint> baseVertices;
+};
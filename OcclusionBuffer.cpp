@@ -0,0 +1,262 @@
+#include "OcclusionBuffer.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_SSE2 1
+#include <emmintrin.h>
+#endif
+
+OcclusionBuffer::OcclusionBuffer(int width, int height)
+    : width((width + 3) & ~3), height(height), depth(size_t((width + 3) & ~3) * height, 1.0f) {
+}
+
+void OcclusionBuffer::begin(const glm::mat4& vp) {
+    viewProj = vp;
+    trianglesRasterized = 0;
+    std::fill(depth.begin(), depth.end(), 1.0f);
+}
+
+void OcclusionBuffer::rasterizeTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+    ScreenTriangle out[2];
+    int count = project(a, b, c, out);
+    for (int i = 0; i < count; ++i)
+        trianglesRasterized += drawScreenTriangle(out[i].v[0], out[i].v[1], out[i].v[2], 0, height);
+}
+
+void OcclusionBuffer::rasterizeTriangles(const glm::vec3* vertices, size_t count) {
+    JobSystem& jobs = JobSystem::instance();
+    screen.resize(count * 2);
+    jobs.parallelFor(0, count, PROJECT_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            ScreenTriangle* out = &screen[i * 2];
+            int projected = project(vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2], out);
+            for (int k = projected; k < 2; ++k) {
+                out[k].minY = 1;
+                out[k].maxY = 0;
+            }
+        }
+    });
+
+    // Every band looks at every triangle, but skips those outside its rows on
+    // the row range alone
+    std::atomic<size_t> drawn{ 0 };
+    const size_t bands = size_t(height + BAND_ROWS - 1) / BAND_ROWS;
+    jobs.parallelFor(0, bands, 1, [&](size_t first, size_t last) {
+        const int rowBegin = int(first) * BAND_ROWS, rowEnd = std::min(height, int(last) * BAND_ROWS);
+        size_t bandDrawn = 0;
+        for (const ScreenTriangle& t : screen) {
+            if (t.maxY < rowBegin || t.minY >= rowEnd || t.maxY < t.minY)
+                continue;
+            bandDrawn += drawScreenTriangle(t.v[0], t.v[1], t.v[2], rowBegin, rowEnd);
+        }
+        drawn += bandDrawn;
+    });
+    trianglesRasterized += drawn.load();
+}
+
+// Up to two screen triangles (x, y in pixels, z in [0, 1]) from a world-space
+// one; none if it's wholly outside the view
+int OcclusionBuffer::project(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, ScreenTriangle* out) const {
+    glm::vec4 clip[3] = {
+        viewProj * glm::vec4(a, 1.0f),
+        viewProj * glm::vec4(b, 1.0f),
+        viewProj * glm::vec4(c, 1.0f)
+    };
+
+    // Trivially reject triangles entirely outside one clip plane
+    for (int axis = 0; axis < 3; ++axis) {
+        if (clip[0][axis] > clip[0].w && clip[1][axis] > clip[1].w && clip[2][axis] > clip[2].w)
+            return 0;
+        if (clip[0][axis] < -clip[0].w && clip[1][axis] < -clip[1].w && clip[2][axis] < -clip[2].w)
+            return 0;
+    }
+
+    // Clip against the near plane (z >= -w); a triangle becomes at most a quad
+    glm::vec4 clipped[4];
+    int count = 0;
+    for (int i = 0; i < 3; ++i) {
+        const glm::vec4& p = clip[i];
+        const glm::vec4& q = clip[(i + 1) % 3];
+        float dp = p.z + p.w, dq = q.z + q.w;
+        if (dp >= 0.0f)
+            clipped[count++] = p;
+        if ((dp >= 0.0f) != (dq >= 0.0f))
+            clipped[count++] = glm::mix(p, q, dp / (dp - dq));
+    }
+    if (count < 3)
+        return 0;
+
+    glm::vec3 screenPos[4];
+    for (int i = 0; i < count; ++i) {
+        float invW = 1.0f / std::max(clipped[i].w, 1e-6f);
+        screenPos[i] = glm::vec3(
+            (clipped[i].x * invW * 0.5f + 0.5f) * width,
+            (clipped[i].y * invW * 0.5f + 0.5f) * height,
+            clipped[i].z * invW * 0.5f + 0.5f
+        );
+    }
+    for (int i = 1; i + 1 < count; ++i) {
+        ScreenTriangle& t = out[i - 1];
+        t.v[0] = screenPos[0];
+        t.v[1] = screenPos[i];
+        t.v[2] = screenPos[i + 1];
+        t.minY = std::max(0, (int)std::floor(std::min({ t.v[0].y, t.v[1].y, t.v[2].y })));
+        t.maxY = std::min(height - 1, (int)std::ceil(std::max({ t.v[0].y, t.v[1].y, t.v[2].y })));
+    }
+    return count - 2;
+}
+
+// Draws the part of the triangle in rows [rowBegin, rowEnd). Returns true
+// for the one band holding its first row, so each is counted once.
+bool OcclusionBuffer::drawScreenTriangle(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, int rowBegin, int rowEnd) {
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+    if (std::abs(area) < 1e-8f)
+        return false;
+    if (area < 0.0f) {
+        std::swap(v1, v2);
+        area = -area;
+    }
+
+    int minX = std::max(0, (int)std::floor(std::min({ v0.x, v1.x, v2.x })));
+    int maxX = std::min(width - 1, (int)std::ceil(std::max({ v0.x, v1.x, v2.x })));
+    int minY = std::max(0, (int)std::floor(std::min({ v0.y, v1.y, v2.y })));
+    int maxY = std::min(height - 1, (int)std::ceil(std::max({ v0.y, v1.y, v2.y })));
+    if (minX > maxX || minY > maxY)
+        return false;
+    const bool first = minY >= rowBegin;
+    minY = std::max(minY, rowBegin);
+    maxY = std::min(maxY, rowEnd - 1);
+    if (minY > maxY)
+        return false;
+    minX &= ~3;
+
+    // Edge functions E(x, y) = A * x + B * y + C, positive inside
+    const float a0 = v1.y - v2.y, b0 = v2.x - v1.x, c0 = v1.x * v2.y - v1.y * v2.x;
+    const float a1 = v2.y - v0.y, b1 = v0.x - v2.x, c1 = v2.x * v0.y - v2.y * v0.x;
+    const float a2 = v0.y - v1.y, b2 = v1.x - v0.x, c2 = v0.x * v1.y - v0.y * v1.x;
+
+    // Depth plane z(x, y) = zA * x + zB * y + zC
+    const float invArea = 1.0f / area;
+    const float zA = (a0 * v0.z + a1 * v1.z + a2 * v2.z) * invArea;
+    const float zB = (b0 * v0.z + b1 * v1.z + b2 * v2.z) * invArea;
+    const float zC = (c0 * v0.z + c1 * v1.z + c2 * v2.z) * invArea;
+
+#if OCCLUSION_SSE2
+    const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+    const __m128 zero = _mm_setzero_ps();
+    for (int y = minY; y <= maxY; ++y) {
+        const float py = y + 0.5f;
+        float* row = depth.data() + size_t(y) * width;
+        for (int x = minX; x <= maxX; x += 4) {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+            __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a0), px), _mm_set1_ps(b0 * py + c0));
+            __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a1), px), _mm_set1_ps(b1 * py + c1));
+            __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a2), px), _mm_set1_ps(b2 * py + c2));
+            __m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero)));
+            if (_mm_movemask_ps(inside) == 0)
+                continue;
+
+            __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zA), px), _mm_set1_ps(zB * py + zC));
+            __m128 old = _mm_loadu_ps(row + x);
+            __m128 closer = _mm_min_ps(old, z);
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, old)));
+        }
+    }
+#else
+    for (int y = minY; y <= maxY; ++y) {
+        const float py = y + 0.5f;
+        float* row = depth.data() + size_t(y) * width;
+        for (int x = minX; x <= maxX; ++x) {
+            const float px = x + 0.5f;
+            if (a0 * px + b0 * py + c0 < 0.0f || a1 * px + b1 * py + c1 < 0.0f || a2 * px + b2 * py + c2 < 0.0f)
+                continue;
+            row[x] = std::min(row[x], zA * px + zB * py + zC);
+        }
+    }
+#endif
+    return first;
+}
+
+bool OcclusionBuffer::testAABB(const glm::vec3& boxMin, const glm::vec3& boxMax) const {
+    float minSX = 1e30f, minSY = 1e30f, maxSX = -1e30f, maxSY = -1e30f, minZ = 1e30f;
+    for (int i = 0; i < 8; ++i) {
+        glm::vec3 corner((i & 1) ? boxMax.x : boxMin.x, (i & 2) ? boxMax.y : boxMin.y, (i & 4) ? boxMax.z : boxMin.z);
+        glm::vec4 clip = viewProj * glm::vec4(corner, 1.0f);
+        if (clip.z < -clip.w)
+            return true;
+        float invW = 1.0f / clip.w;
+        float sx = (clip.x * invW * 0.5f + 0.5f) * width;
+        float sy = (clip.y * invW * 0.5f + 0.5f) * height;
+        minSX = std::min(minSX, sx);
+        maxSX = std::max(maxSX, sx);
+        minSY = std::min(minSY, sy);
+        maxSY = std::max(maxSY, sy);
+        minZ = std::min(minZ, clip.z * invW * 0.5f + 0.5f);
+    }
+
+    // Dilate by a pixel so sub-pixel slivers are never culled
+    int x0 = std::max(0, (int)std::floor(minSX) - 1);
+    int x1 = std::min(width - 1, (int)std::ceil(maxSX) + 1);
+    int y0 = std::max(0, (int)std::floor(minSY) - 1);
+    int y1 = std::min(height - 1, (int)std::ceil(maxSY) + 1);
+    if (x0 > x1 || y0 > y1)
+        return true; // off screen; leave that to frustum culling
+
+#if OCCLUSION_SSE2
+    const __m128 boxZ = _mm_set1_ps(minZ);
+    const int x0a = x0 & ~3;
+    for (int y = y0; y <= y1; ++y) {
+        const float* row = depth.data() + size_t(y) * width;
+        for (int x = x0a; x <= x1; x += 4) {
+            // Lanes outside [x0, x1] only widen the test, which stays conservative
+            if (_mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(row + x), boxZ)) != 0)
+                return true;
+        }
+    }
+#else
+    for (int y = y0; y <= y1; ++y) {
+        const float* row = depth.data() + size_t(y) * width;
+        for (int x = x0; x <= x1; ++x) {
+            if (row[x] > minZ)
+                return true;
+        }
+    }
+#endif
+    return false;
+}
+
+TerrainOccluders::TerrainOccluders(const HeightfieldMinMax& minMax, float spacing, int level) {
+    level = std::clamp(level, 0, (int)minMax.levels.size() - 1);
+    const MinMaxLevel& l = minMax.levels[level];
+    const int step = 1 << level;
+
+    // Grid vertex (i, j) sits on the corner shared by up to four texels
+    auto vertex = [&](int i, int j) {
+        float h = 1e30f;
+        for (int dj = -1; dj <= 0; ++dj) {
+            for (int di = -1; di <= 0; ++di) {
+                int ti = i + di, tj = j + dj;
+                if (ti >= 0 && tj >= 0 && ti < l.w && tj < l.h)
+                    h = std::min(h, l.minH[tj * l.w + ti]);
+            }
+        }
+        float x = std::min(i * step, minMax.cellsW) * spacing;
+        float z = std::min(j * step, minMax.cellsH) * spacing;
+        return glm::vec3(x, h, z);
+    };
+
+    for (int j = 0; j < l.h; ++j) {
+        for (int i = 0; i < l.w; ++i) {
+            glm::vec3 v00 = vertex(i, j), v10 = vertex(i + 1, j);
+            glm::vec3 v01 = vertex(i, j + 1), v11 = vertex(i + 1, j + 1);
+            triangles.insert(triangles.end(), { v00, v01, v10, v10, v01, v11 });
+        }
+    }
+}
+
+void TerrainOccluders::render(OcclusionBuffer& buffer) const {
+    buffer.rasterizeTriangles(triangles.data(), triangles.size() / 3);
+}
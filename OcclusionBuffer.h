@@ -0,0 +1,63 @@
+#pragma once
+#include "HeightfieldMinMax.h"
+#include <glm.hpp>
+#include <cstddef>
+#include <vector>
+
+// Low-resolution CPU depth buffer for occlusion culling. Occluder triangles
+// are rasterized four pixels at a time (SSE2 where available) and bounding
+// boxes are tested against the result before anything reaches the GPU.
+// Depth is NDC z remapped to [0, 1], cleared to 1.
+class OcclusionBuffer {
+public:
+    int width, height;          // width is rounded up to a multiple of 4
+    std::vector<float> depth;
+    glm::mat4 viewProj{ 1.0f };
+
+    // Stats for the current frame
+    size_t trianglesRasterized = 0;
+
+    OcclusionBuffer(int width = 256, int height = 128);
+
+    void begin(const glm::mat4& viewProj);
+    void rasterizeTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+
+    // count triangles, 3 vertices each, across the job system: projected and
+    // clipped in parallel, then drawn in bands of rows, a job per band. Each
+    // pixel keeps the nearest depth, so the result is the same as drawing
+    // them one at a time.
+    void rasterizeTriangles(const glm::vec3* vertices, size_t count);
+
+    static const size_t PROJECT_GRAIN = 1024;   // triangles per projection job
+    static const int BAND_ROWS = 16;            // rows per drawing job
+
+    // True if any part of the box may be visible. Boxes crossing the near
+    // plane are always visible.
+    bool testAABB(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+
+private:
+    // A projected triangle and the rows it covers; empty if maxY < minY
+    struct ScreenTriangle {
+        glm::vec3 v[3];
+        int minY, maxY;
+    };
+
+    // Two per triangle given to rasterizeTriangles, as clipping to the near
+    // plane can make a quad. Kept between frames for its capacity.
+    std::vector<ScreenTriangle> screen;
+
+    int project(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, ScreenTriangle* out) const;
+    bool drawScreenTriangle(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, int rowBegin, int rowEnd);
+};
+
+// Conservative terrain occluders: a coarse grid built from one level of the
+// min pyramid. Every vertex takes the minimum of the texels around it, so the
+// occluder surface never rises above the real terrain.
+class TerrainOccluders {
+public:
+    std::vector<glm::vec3> triangles;   // 3 vertices per triangle
+
+    TerrainOccluders(const HeightfieldMinMax& minMax, float spacing, int level);
+
+    void render(OcclusionBuffer& buffer) const;
+};
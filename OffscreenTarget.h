@@ -0,0 +1,18 @@
+#pragma once
+#include <glad/gl.h>
+#include <vector>
+
+// Framebuffer object with an RGBA8 color and a 24-bit depth renderbuffer,
+// standing in for the window's default framebuffer in headless runs.
+class OffscreenTarget {
+public:
+    GLuint fbo = 0, color = 0, depth = 0;
+    int width = 0, height = 0;
+
+    bool init(int w, int h);
+    void bind();
+
+    // Tightly packed RGB, top row first
+    void readPixels(std::vector<unsigned char>& rgb);
+    void destroy();
+};
@@ -0,0 +1,142 @@
+#include "PatchRenderer.h"
+#include "HeightTexture.h"
+#include <algorithm>
+#include <cstring>
+
+const char* patchVertSrc = R"(
+#version 330 core
+layout(location = 0) in vec2 gridPos;   // patch vertex, 0..patchSize
+layout(location = 1) in vec4 tile;      // cellX, cellZ, scale, unused
+out float vHeight;
+layout(std140) uniform Frame {
+    mat4 mvp;
+    vec4 cameraPos;
+};
+layout(std140) uniform TerrainGrid {
+    vec4 grid;                          // last vertex index x/z, spacing
+};
+uniform sampler2D heightTex;
+
+void main() {
+    vec2 cell = min(tile.xy + gridPos * tile.z, grid.xy);
+    float h = texture(heightTex, (cell + 0.5) / vec2(textureSize(heightTex, 0))).r;
+    vec3 world = vec3(cell.x * grid.z, h, cell.y * grid.z);
+    gl_Position = mvp * vec4(world, 1.0);
+    vHeight = world.y;
+})";
+
+void PatchRenderer::init(const std::vector<std::vector<float>>& heightMap, float spacing_, int tileCells_, int patchSize_, GLuint prog) {
+    program = prog;
+    spacing = spacing_;
+    tileCells = tileCells_;
+    patchSize = patchSize_;
+    gridH = (int)heightMap.size();
+    gridW = gridH > 0 ? (int)heightMap[0].size() : 0;
+
+    bindUniformBlock(program, "Frame", FRAME_UNIFORM_BINDING);
+    bindUniformBlock(program, "TerrainGrid", DRAW_UNIFORM_BINDING);
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "heightTex"), 0);
+
+    heightTex = createHeightTexture(heightMap);
+
+    const int n = patchSize;
+    std::vector<float> grid;
+    for (int y = 0; y <= n; ++y) {
+        for (int x = 0; x <= n; ++x) {
+            grid.push_back((float)x);
+            grid.push_back((float)y);
+        }
+    }
+
+    std::vector<unsigned short> indices;
+    for (int y = 0; y < n; ++y) {
+        for (int x = 0; x < n; ++x) {
+            unsigned short v0 = (unsigned short)(y * (n + 1) + x);
+            unsigned short v1 = v0 + 1;
+            unsigned short v2 = (unsigned short)(v0 + (n + 1));
+            unsigned short v3 = v2 + 1;
+            indices.insert(indices.end(), { v0, v2, v1, v1, v2, v3 });
+        }
+    }
+    indexCount = (GLsizei)indices.size();
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &patchVbo);
+    glGenBuffers(1, &patchEbo);
+    glGenBuffers(1, &instanceVbo);
+
+    glBindVertexArray(vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, patchVbo);
+    glBufferData(GL_ARRAY_BUFFER, grid.size() * sizeof(float), grid.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)0);
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(1);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, patchEbo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), indices.data(), GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+}
+
+void PatchRenderer::draw(const std::vector<TerrainChunk>& chunks, const std::vector<int>& visible,
+                         StreamBuffer& stream, GLStateCache& state) {
+    const float scale = (float)tileCells / patchSize;
+    instances.clear();
+    for (int i : visible) {
+        const TerrainChunk& c = chunks[i];
+        instances.push_back({ (float)c.cellX, (float)c.cellZ, scale, 0.0f });
+    }
+    lastInstanceCount = instances.size();
+    lastTriangleCount = lastInstanceCount * indexCount / 3;
+    if (instances.empty())
+        return;
+
+    const size_t bytes = instances.size() * sizeof(Instance);
+    state.bindVertexArray(vao);
+
+    size_t instanceBase = 0;
+    if (void* dst = stream.map(bytes, sizeof(Instance), instanceBase)) {
+        std::memcpy(dst, instances.data(), bytes);
+        stream.unmap();
+        glBindBuffer(GL_ARRAY_BUFFER, stream.buffer);
+    }
+    else {
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+        if (instances.size() > instanceCapacity) {
+            instanceCapacity = std::max(instances.size(), instanceCapacity * 2);
+            glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(Instance), nullptr, GL_STREAM_DRAW);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, instances.data());
+    }
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)instanceBase);
+
+    TerrainGridUniforms block;
+    block.grid = glm::vec4((float)(gridW - 1), (float)(gridH - 1), spacing, 0.0f);
+    pushUniformBlock(stream, DRAW_UNIFORM_BINDING, block);
+
+    state.useProgram(program);
+    state.bindTexture(0, GL_TEXTURE_2D, heightTex);
+
+    glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_SHORT, (void*)0, (GLsizei)instances.size());
+}
+
+size_t PatchRenderer::geometryBytes() const {
+    const size_t verts = size_t(patchSize + 1) * (patchSize + 1);
+    return verts * 2 * sizeof(float) + indexCount * sizeof(unsigned short);
+}
+
+void PatchRenderer::destroy() {
+    glDeleteTextures(1, &heightTex);
+    glDeleteBuffers(1, &instanceVbo);
+    glDeleteBuffers(1, &patchEbo);
+    glDeleteBuffers(1, &patchVbo);
+    glDeleteVertexArrays(1, &vao);
+    vao = patchVbo = patchEbo = instanceVbo = heightTex = 0;
+    instanceCapacity = 0;
+}
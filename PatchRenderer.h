@@ -0,0 +1,50 @@
+#pragma once
+#include "TerrainChunks.h"
+#include "StreamBuffer.h"
+#include "GLStateCache.h"
+#include "UniformBlocks.h"
+#include <glad/gl.h>
+#include <glm.hpp>
+#include <vector>
+
+extern const char* patchVertSrc;
+
+// One shared NxN grid patch, instanced once per visible terrain tile, with
+// heights fetched from a texture. Geometry memory is a single patch no
+// matter how large the world is; only the height texture scales with it.
+class PatchRenderer {
+public:
+    struct Instance {
+        float cellX, cellZ;     // tile origin, in heightmap cells
+        float scale;            // cells per patch quad
+        float pad;
+    };
+
+    GLuint program = 0;
+    GLuint vao = 0, patchVbo = 0, patchEbo = 0, instanceVbo = 0, heightTex = 0;
+    int tileCells = 0;
+    int patchSize = 0;
+    GLsizei indexCount = 0;
+    size_t instanceCapacity = 0;
+
+    // Stats for the last draw()
+    size_t lastInstanceCount = 0;
+    size_t lastTriangleCount = 0;
+
+    // prog must be linked from patchVertSrc. Every tile is drawn with the
+    // same scale, tileCells / patchSize, so neighbouring patches always share
+    // edge vertices; the partial tiles at the far edges are clamped instead.
+    // draw() expects the Frame block bound and pushes its own TerrainGrid.
+    void init(const std::vector<std::vector<float>>& heightMap, float spacing, int tileCells, int patchSize, GLuint prog);
+    void draw(const std::vector<TerrainChunk>& chunks, const std::vector<int>& visible,
+              StreamBuffer& stream, GLStateCache& state);
+    void destroy();
+
+    // Bytes of GPU geometry, excluding the height texture
+    size_t geometryBytes() const;
+
+private:
+    std::vector<Instance> instances;
+    int gridW = 0, gridH = 0;
+    float spacing = 0.0f;
+};
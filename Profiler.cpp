@@ -0,0 +1,238 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+bool ProfileThreadBuffer::push(const ProfileEvent& event) {
+    size_t head = writePos.load(std::memory_order_relaxed);
+    if (head - readPos.load(std::memory_order_acquire) >= CAPACITY) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    events[head % CAPACITY] = event;
+    writePos.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+Profiler& Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+uint64_t Profiler::nowNs() {
+    using Clock = std::chrono::steady_clock;
+    static const Clock::time_point epoch = Clock::now();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch).count();
+}
+
+ProfileThreadBuffer& Profiler::threadBuffer() {
+    thread_local ProfileThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        threads.push_back(std::make_unique<ProfileThreadBuffer>());
+        buffer = threads.back().get();
+        buffer->threadId = (uint32_t)threads.size();
+        buffer->name = "Thread " + std::to_string(threads.size());
+    }
+    return *buffer;
+}
+
+void Profiler::setThreadName(const char* name) {
+    ProfileThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer.name = name;
+}
+
+void Profiler::record(const char* name, uint64_t startNs, uint64_t endNs) {
+    threadBuffer().push({ name, startNs, endNs });
+}
+
+void Profiler::initGpu() {
+    gpuTimers = GLAD_GL_VERSION_3_3 || GLAD_GL_ARB_timer_query;
+}
+
+void Profiler::beginGpuZone(const char* name) {
+    if (!gpuTimers)
+        return;
+    if (gpuZoneDepth++ > 0) {
+        ++skippedGpuZones;
+        return;
+    }
+    GpuFrame& frame = gpuFrames[frameIndex % GPU_LATENCY];
+    if (frame.queries.size() == frame.pool.size()) {
+        GLuint query;
+        glGenQueries(1, &query);
+        frame.pool.push_back(query);
+    }
+    glBeginQuery(GL_TIME_ELAPSED, frame.pool[frame.queries.size()]);
+    frame.queries.push_back({ name, nowNs() });
+}
+
+void Profiler::endGpuZone() {
+    if (!gpuTimers || --gpuZoneDepth > 0)
+        return;
+    glEndQuery(GL_TIME_ELAPSED);
+}
+
+void Profiler::resolveGpuFrame(GpuFrame& frame) {
+    // GPU_LATENCY frames old, so the results are normally in already
+    for (size_t i = 0; i < frame.queries.size(); ++i) {
+        GLuint64 elapsedNs = 0;
+        glGetQueryObjectui64v(frame.pool[i], GL_QUERY_RESULT, &elapsedNs);
+        const GpuQuery& q = frame.queries[i];
+        addSample(q.name, true, q.cpuStartNs, q.cpuStartNs + elapsedNs, GPU_THREAD_ID);
+    }
+    frame.queries.clear();
+}
+
+void Profiler::addSample(const char* name, bool gpu, uint64_t startNs, uint64_t endNs, uint32_t threadId) {
+    auto& cache = gpu ? gpuZoneCache : cpuZoneCache;
+    auto cached = cache.find(name);
+    ZoneHistory* zone;
+    if (cached != cache.end()) {
+        zone = cached->second;
+    }
+    else {
+        zone = &zones[gpu ? std::string("GPU ") + name : std::string(name)];
+        zone->gpu = gpu;
+        zone->samples.reserve(HISTORY);
+        cache[name] = zone;
+    }
+    zone->frameMs += (endNs - startNs) * 1e-6f;
+    zone->seen = true;
+
+    if (capturing && trace.size() < captureLimit)
+        trace.push_back({ { name, startNs, endNs }, threadId });
+}
+
+void Profiler::endFrame() {
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        droppedEvents = 0;
+        for (auto& buffer : threads) {
+            uint32_t id = buffer->threadId;
+            buffer->drain([&](const ProfileEvent& e) {
+                addSample(e.name, false, e.startNs, e.endNs, id);
+            });
+            droppedEvents += buffer->dropped.load(std::memory_order_relaxed);
+        }
+    }
+
+    ++frameIndex;
+    if (gpuTimers)
+        resolveGpuFrame(gpuFrames[frameIndex % GPU_LATENCY]);
+
+    // Zones contribute one sample per frame they ran in
+    for (auto& entry : zones) {
+        ZoneHistory& zone = entry.second;
+        if (!zone.seen)
+            continue;
+        if (zone.samples.size() < HISTORY)
+            zone.samples.push_back(zone.frameMs);
+        else
+            zone.samples[zone.next] = zone.frameMs;
+        zone.next = (zone.next + 1) % HISTORY;
+        zone.frameMs = 0.0f;
+        zone.seen = false;
+    }
+}
+
+void Profiler::destroy() {
+    for (GpuFrame& frame : gpuFrames) {
+        if (!frame.pool.empty())
+            glDeleteQueries((GLsizei)frame.pool.size(), frame.pool.data());
+        frame.pool.clear();
+        frame.queries.clear();
+    }
+    gpuTimers = false;
+}
+
+void Profiler::startCapture(size_t maxEvents) {
+    capturing = true;
+    captureLimit = maxEvents;
+    trace.clear();
+    trace.reserve(std::min<size_t>(maxEvents, 1 << 16));
+}
+
+bool Profiler::writeChromeTrace(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Can't write trace " << path << "\n";
+        return false;
+    }
+
+    auto writeName = [&](const std::string& name) {
+        out << '"';
+        for (char c : name) {
+            if (c == '"' || c == '\\')
+                out << '\\';
+            out << c;
+        }
+        out << '"';
+    };
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << GPU_THREAD_ID << ",\"args\":{\"name\":\"GPU\"}}";
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const auto& buffer : threads) {
+            out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId << ",\"args\":{\"name\":";
+            writeName(buffer->name);
+            out << "}}";
+        }
+    }
+
+    // Microseconds, as the format expects
+    out << std::fixed << std::setprecision(3);
+    for (const TraceEvent& t : trace) {
+        out << ",\n{\"name\":";
+        writeName(t.event.name);
+        out << ",\"cat\":\"" << (t.threadId == GPU_THREAD_ID ? "gpu" : "cpu") << "\",\"ph\":\"X\""
+            << ",\"ts\":" << t.event.startNs / 1000.0
+            << ",\"dur\":" << (t.event.endNs - t.event.startNs) / 1000.0
+            << ",\"pid\":1,\"tid\":" << t.threadId << "}";
+    }
+    out << "\n]}\n";
+    return (bool)out;
+}
+
+std::vector<ZoneSummary> Profiler::summarize() const {
+    std::vector<ZoneSummary> result;
+    for (const auto& entry : zones) {
+        const ZoneHistory& zone = entry.second;
+        if (zone.samples.empty())
+            continue;
+        ZoneSummary s;
+        s.name = entry.first;
+        s.gpu = zone.gpu;
+        s.lastMs = zone.samples[(zone.next + HISTORY - 1) % HISTORY % zone.samples.size()];
+        s.time = summarizeFrameTimes(zone.samples);
+        result.push_back(s);
+    }
+    // CPU zones first, most expensive first
+    std::sort(result.begin(), result.end(), [](const ZoneSummary& a, const ZoneSummary& b) {
+        if (a.gpu != b.gpu)
+            return !a.gpu;
+        return a.time.p50Ms > b.time.p50Ms;
+    });
+    return result;
+}
+
+void Profiler::printSummary(std::ostream& out) const {
+    std::vector<ZoneSummary> summary = summarize();
+    std::ios::fmtflags flags = out.flags();
+    out << std::left << std::setw(24) << "Zone (ms)" << std::right
+        << std::setw(9) << "last" << std::setw(9) << "p50" << std::setw(9) << "p95" << std::setw(9) << "p99"
+        << std::setw(9) << "max" << std::setw(8) << "frames" << "\n";
+    out << std::fixed << std::setprecision(3);
+    for (const ZoneSummary& z : summary) {
+        out << std::left << std::setw(24) << z.name << std::right
+            << std::setw(9) << z.lastMs << std::setw(9) << z.time.p50Ms << std::setw(9) << z.time.p95Ms
+            << std::setw(9) << z.time.p99Ms << std::setw(9) << z.time.maxMs << std::setw(8) << z.time.frames << "\n";
+    }
+    if (droppedEvents || skippedGpuZones)
+        out << "Dropped events: " << droppedEvents << ", nested GPU zones skipped: " << skippedGpuZones << "\n";
+    out.flags(flags);
+}
@@ -0,0 +1,175 @@
+#pragma once
+#include <glad/gl.h>
+#include "FrameTimeStats.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Compile-time switch: build with LOTUS_PROFILE=0 and PROFILE_ZONE /
+// PROFILE_GPU_ZONE compile to nothing.
+#ifndef LOTUS_PROFILE
+#define LOTUS_PROFILE 1
+#endif
+
+struct ProfileEvent {
+    const char* name;       // string literal, never copied
+    uint64_t startNs;
+    uint64_t endNs;
+};
+
+// Events from one thread. Only the owning thread pushes and only the GL
+// thread drains (in Profiler::endFrame), so the ring needs nothing more than
+// an acquire/release pair on each index. A full buffer drops events.
+class ProfileThreadBuffer {
+public:
+    static const size_t CAPACITY = 4096;
+
+    uint32_t threadId = 0;
+    std::string name;
+    std::atomic<size_t> dropped{ 0 };
+
+    bool push(const ProfileEvent& event);
+
+    template <typename F>
+    void drain(F&& consume) {
+        size_t tail = readPos.load(std::memory_order_relaxed);
+        size_t head = writePos.load(std::memory_order_acquire);
+        for (; tail != head; ++tail)
+            consume(events[tail % CAPACITY]);
+        readPos.store(tail, std::memory_order_release);
+    }
+
+private:
+    ProfileEvent events[CAPACITY];
+    alignas(64) std::atomic<size_t> writePos{ 0 };
+    alignas(64) std::atomic<size_t> readPos{ 0 };
+};
+
+struct ZoneSummary {
+    std::string name;
+    bool gpu = false;
+    float lastMs = 0.0f;
+    FrameTimeSummary time;  // per-frame totals over the history window
+};
+
+// Frame profiler: CPU zones from any thread, GPU zones from GL_TIME_ELAPSED
+// queries, per-zone percentiles over the last HISTORY frames, and a Chrome
+// trace (chrome://tracing, Perfetto) of captured frames.
+class Profiler {
+public:
+    static const size_t HISTORY = 300;
+    static const size_t GPU_LATENCY = 4;    // frames before a query is read back
+
+    bool gpuTimers = false;
+    size_t droppedEvents = 0;
+    size_t skippedGpuZones = 0;             // nested GPU zones, which TIME_ELAPSED can't do
+
+    static Profiler& instance();
+    static uint64_t nowNs();
+
+    // Any thread
+    void setThreadName(const char* name);
+    void record(const char* name, uint64_t startNs, uint64_t endNs);
+
+    // GL thread. initGpu enables GPU zones when timer queries exist.
+    void initGpu();
+    void beginGpuZone(const char* name);
+    void endGpuZone();
+    void endFrame();
+    void destroy();
+
+    // Keeps every event from now on, up to maxEvents
+    void startCapture(size_t maxEvents = 1 << 20);
+    bool writeChromeTrace(const std::string& path) const;
+
+    std::vector<ZoneSummary> summarize() const;
+    void printSummary(std::ostream& out) const;
+
+private:
+    struct ZoneHistory {
+        bool gpu = false;
+        float frameMs = 0.0f;       // accumulating for the current frame
+        bool seen = false;
+        std::vector<float> samples; // ring of HISTORY per-frame totals
+        size_t next = 0;
+    };
+
+    struct GpuQuery {
+        const char* name;
+        uint64_t cpuStartNs;        // trace placement; the GPU only gives a duration
+    };
+
+    struct GpuFrame {
+        std::vector<GLuint> pool;
+        std::vector<GpuQuery> queries;
+    };
+
+    struct TraceEvent {
+        ProfileEvent event;
+        uint32_t threadId;
+    };
+
+    static const uint32_t GPU_THREAD_ID = 0xFFFF;
+
+    Profiler() = default;
+    ProfileThreadBuffer& threadBuffer();
+    void addSample(const char* name, bool gpu, uint64_t startNs, uint64_t endNs, uint32_t threadId);
+    void resolveGpuFrame(GpuFrame& frame);
+
+    mutable std::mutex registryMutex;
+    std::vector<std::unique_ptr<ProfileThreadBuffer>> threads;
+    std::unordered_map<std::string, ZoneHistory> zones;
+    // Zone names are literals: cache their lookups so steady-state frames
+    // don't build strings
+    std::unordered_map<const char*, ZoneHistory*> cpuZoneCache;
+    std::unordered_map<const char*, ZoneHistory*> gpuZoneCache;
+
+    GpuFrame gpuFrames[GPU_LATENCY];
+    size_t frameIndex = 0;
+    int gpuZoneDepth = 0;
+
+    bool capturing = false;
+    size_t captureLimit = 0;
+    std::vector<TraceEvent> trace;
+};
+
+// Times its scope on the calling thread
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name) : name(name), startNs(Profiler::nowNs()) {}
+    ~ProfileZone() { Profiler::instance().record(name, startNs, Profiler::nowNs()); }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* name;
+    uint64_t startNs;
+};
+
+// Times the GL commands issued in its scope; GL thread only, not nestable
+class GpuProfileZone {
+public:
+    explicit GpuProfileZone(const char* name) { Profiler::instance().beginGpuZone(name); }
+    ~GpuProfileZone() { Profiler::instance().endGpuZone(); }
+
+    GpuProfileZone(const GpuProfileZone&) = delete;
+    GpuProfileZone& operator=(const GpuProfileZone&) = delete;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if LOTUS_PROFILE
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_GPU_ZONE(name) GpuProfileZone PROFILE_CONCAT(gpuProfileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_GPU_ZONE(name) ((void)0)
+#endif
@@ -0,0 +1,234 @@
+#include "ProgramCache.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const uint32_t BINARY_MAGIC = 0x4250564C; // "LVPB"
+
+uint64_t fnv1a(uint64_t h, const char* s) {
+    for (; *s; ++s) {
+        h ^= (unsigned char)*s;
+        h *= 1099511628211ull;
+    }
+    // Separator, so "ab" + "c" and "a" + "bc" hash differently
+    h ^= 0xFF;
+    h *= 1099511628211ull;
+    return h;
+}
+
+const char* glString(GLenum name) {
+    const GLubyte* s = glGetString(name);
+    return s ? (const char*)s : "";
+}
+
+}
+
+ProgramCache::ProgramCache(const std::string& directory)
+    : directory(directory) {
+}
+
+void ProgramCache::init() {
+    driverId = std::string(glString(GL_VENDOR)) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION);
+
+    GLint formats = 0;
+    if (GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    binaries = formats > 0;
+    if (binaries) {
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        if (ec) {
+            std::cerr << "Program cache: can't create " << directory << ": " << ec.message() << "\n";
+            binaries = false;
+        }
+    }
+
+    if (GLAD_GL_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+        parallel = true;
+    }
+    else if (GLAD_GL_ARB_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+        parallel = true;
+    }
+}
+
+uint64_t ProgramCache::keyFor(const char* vsSrc, const char* fsSrc) const {
+    uint64_t h = 14695981039346656037ull;
+    h = fnv1a(h, vsSrc);
+    h = fnv1a(h, fsSrc);
+    h = fnv1a(h, driverId.c_str());
+    return h;
+}
+
+std::string ProgramCache::pathFor(uint64_t key) const {
+    static const char* hex = "0123456789abcdef";
+    std::string name(16, '0');
+    for (int i = 15; i >= 0; --i, key >>= 4)
+        name[i] = hex[key & 0xF];
+    return directory + "/" + name + ".bin";
+}
+
+GLuint ProgramCache::loadBinary(uint64_t key) {
+    if (!binaries)
+        return 0;
+    std::ifstream in(pathFor(key), std::ios::binary);
+    if (!in)
+        return 0;
+
+    uint32_t header[3];
+    if (!in.read((char*)header, sizeof(header)) || header[0] != BINARY_MAGIC)
+        return 0;
+    // A truncated or corrupt file mustn't size the read: only a length that
+    // matches the rest of the file is trusted
+    std::streamoff start = in.tellg();
+    in.seekg(0, std::ios::end);
+    std::streamoff remaining = in.tellg() - start;
+    in.seekg(start);
+    if (header[2] == 0 || remaining != (std::streamoff)header[2])
+        return 0;
+    std::vector<char> data(header[2]);
+    if (!in.read(data.data(), data.size()))
+        return 0;
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, (GLenum)header[1], data.data(), (GLsizei)data.size());
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    ++hits;
+    return program;
+}
+
+void ProgramCache::storeBinary(uint64_t key, GLuint program) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> data(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, data.data());
+
+    std::ofstream out(pathFor(key), std::ios::binary | std::ios::trunc);
+    uint32_t header[3] = { BINARY_MAGIC, (uint32_t)format, (uint32_t)length };
+    out.write((const char*)header, sizeof(header));
+    out.write(data.data(), length);
+    if (out)
+        ++stores;
+    else
+        std::cerr << "Program cache: failed to write " << pathFor(key) << "\n";
+}
+
+ProgramCache::Pending ProgramCache::startCompile(uint64_t key, const char* vsSrc, const char* fsSrc) {
+    ++misses;
+    Pending p;
+    p.key = key;
+    p.vs = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(p.vs, 1, &vsSrc, nullptr);
+    glCompileShader(p.vs);
+    p.fs = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(p.fs, 1, &fsSrc, nullptr);
+    glCompileShader(p.fs);
+
+    // No status queries here; they would wait for the compile to finish
+    p.program = glCreateProgram();
+    if (binaries)
+        glProgramParameteri(p.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(p.program, p.vs);
+    glAttachShader(p.program, p.fs);
+    glLinkProgram(p.program);
+    return p;
+}
+
+GLuint ProgramCache::finish(Pending& p) {
+    int success;
+    glGetProgramiv(p.program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char log[512];
+        for (GLuint shader : { p.vs, p.fs }) {
+            int compiled;
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+            if (!compiled) {
+                glGetShaderInfoLog(shader, 512, nullptr, log);
+                std::cerr << "Shader compile error:\n" << log << "\n";
+            }
+        }
+        glGetProgramInfoLog(p.program, 512, nullptr, log);
+        std::cerr << "Program link error:\n" << log << "\n";
+    }
+    glDetachShader(p.program, p.vs);
+    glDetachShader(p.program, p.fs);
+    glDeleteShader(p.vs);
+    glDeleteShader(p.fs);
+
+    if (success && binaries)
+        storeBinary(p.key, p.program);
+    return p.program;
+}
+
+void ProgramCache::precompile(const std::vector<ProgramSource>& variants) {
+    for (const ProgramSource& v : variants) {
+        uint64_t key = keyFor(v.vsSrc, v.fsSrc);
+        if (ready.count(key))
+            continue;
+        bool inFlight = false;
+        for (const Pending& p : pending)
+            inFlight = inFlight || p.key == key;
+        if (inFlight)
+            continue;
+
+        if (GLuint program = loadBinary(key))
+            ready[key] = program;
+        else
+            pending.push_back(startCompile(key, v.vsSrc, v.fsSrc));
+    }
+}
+
+GLuint ProgramCache::get(const char* vsSrc, const char* fsSrc) {
+    uint64_t key = keyFor(vsSrc, fsSrc);
+
+    auto it = ready.find(key);
+    if (it != ready.end()) {
+        GLuint program = it->second;
+        ready.erase(it);
+        return program;
+    }
+    for (size_t i = 0; i < pending.size(); ++i) {
+        if (pending[i].key == key) {
+            Pending p = pending[i];
+            pending.erase(pending.begin() + i);
+            return finish(p);
+        }
+    }
+
+    if (GLuint program = loadBinary(key))
+        return program;
+    Pending p = startCompile(key, vsSrc, fsSrc);
+    return finish(p);
+}
+
+void ProgramCache::pump() {
+    size_t finished = 0;
+    for (size_t i = 0; i < pending.size();) {
+        int done = GL_TRUE;
+        if (parallel)
+            glGetProgramiv(pending[i].program, GL_COMPLETION_STATUS_KHR, &done);
+        else if (finished > 0)
+            break;  // without the extension, finish at most one per call
+
+        if (!done) {
+            ++i;
+            continue;
+        }
+        Pending p = pending[i];
+        pending.erase(pending.begin() + i);
+        ready[p.key] = finish(p);
+        ++finished;
+    }
+}
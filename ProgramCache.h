@@ -0,0 +1,58 @@
+#pragma once
+#include <glad/gl.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ProgramSource {
+    const char* vsSrc;
+    const char* fsSrc;
+};
+
+// Linked program binaries on disk, keyed by a hash of both shader sources
+// and the driver's vendor, renderer and version strings, so a driver update
+// simply misses instead of loading an incompatible binary. Binaries that the
+// driver still rejects are recompiled and overwritten.
+//
+// precompile() starts compiling every variant at once without waiting; with
+// KHR/ARB_parallel_shader_compile the driver spreads them over its own
+// threads. get() hands out a program, finishing it first if it's still in
+// flight, and pump() stores finished precompiles without ever blocking.
+class ProgramCache {
+public:
+    // Stats
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t stores = 0;
+
+    explicit ProgramCache(const std::string& directory = "shader_cache");
+
+    // Needs a current context
+    void init();
+    bool binarySupported() const { return binaries; }
+
+    void precompile(const std::vector<ProgramSource>& variants);
+    GLuint get(const char* vsSrc, const char* fsSrc);
+    void pump();
+
+private:
+    struct Pending {
+        uint64_t key;
+        GLuint program, vs, fs;
+    };
+
+    std::string directory;
+    std::string driverId;
+    bool binaries = false;
+    bool parallel = false;
+    std::unordered_map<uint64_t, GLuint> ready;
+    std::vector<Pending> pending;
+
+    uint64_t keyFor(const char* vsSrc, const char* fsSrc) const;
+    std::string pathFor(uint64_t key) const;
+    GLuint loadBinary(uint64_t key);
+    void storeBinary(uint64_t key, GLuint program);
+    Pending startCompile(uint64_t key, const char* vsSrc, const char* fsSrc);
+    GLuint finish(Pending& p);
+};
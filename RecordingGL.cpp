@@ -0,0 +1,513 @@
+#include "RecordingGL.h"
+#include <cstring>
+#include <memory>
+
+struct RecordingGL::State {
+    GLuint nextName = 1;
+    uintptr_t nextSync = 1;
+    std::unordered_map<GLuint, std::vector<unsigned char>> buffers;
+    std::unordered_map<GLenum, GLuint> bound;       // by target, except element arrays
+    std::unordered_map<GLuint, GLuint> vaoElements; // element array binding per VAO
+    GLuint vao = 0;
+};
+
+RecordingGL& RecordingGL::instance() {
+    static RecordingGL gl;
+    return gl;
+}
+
+RecordingGL::State& RecordingGL::state() {
+    static State s;
+    return s;
+}
+
+void RecordingGL::reset() {
+    stats = GLRecordStats();
+    commands.clear();
+    for (auto& entry : callCounts)
+        entry.second = 0;
+}
+
+size_t RecordingGL::count(const char* name) const {
+    auto it = callCounts.find(name);
+    return it == callCounts.end() ? 0 : it->second;
+}
+
+namespace {
+
+RecordingGL& rec() {
+    return RecordingGL::instance();
+}
+
+RecordingGL::State& st() {
+    return RecordingGL::instance().state();
+}
+
+void record(const char* name) {
+    RecordingGL& r = rec();
+    ++r.stats.calls;
+    ++r.callCounts[name];
+    if (r.keepCommands)
+        r.commands.push_back(name);
+}
+
+GLuint& binding(GLenum target) {
+    if (target == GL_ELEMENT_ARRAY_BUFFER)
+        return st().vaoElements[st().vao];
+    return st().bound[target];
+}
+
+std::vector<unsigned char>* boundStorage(GLenum target) {
+    GLuint b = binding(target);
+    auto it = st().buffers.find(b);
+    return it == st().buffers.end() ? nullptr : &it->second;
+}
+
+size_t texelBytes(GLenum format, GLenum type) {
+    size_t components = format == GL_RED ? 1 : format == GL_RG ? 2 : format == GL_RGB ? 3 : 4;
+    size_t size = (type == GL_FLOAT || type == GL_UNSIGNED_INT || type == GL_INT) ? 4
+        : (type == GL_HALF_FLOAT || type == GL_UNSIGNED_SHORT || type == GL_SHORT) ? 2 : 1;
+    return components * size;
+}
+
+void genNames(GLsizei n, GLuint* names) {
+    for (GLsizei i = 0; i < n; ++i)
+        names[i] = st().nextName++;
+    rec().stats.objectsCreated += n;
+}
+
+void stateChange(const char* name) {
+    record(name);
+    ++rec().stats.stateChanges;
+}
+
+void uniformUpdate(const char* name) {
+    record(name);
+    ++rec().stats.uniformUpdates;
+}
+
+void draw(const char* name, size_t indices) {
+    record(name);
+    ++rec().stats.drawCalls;
+    rec().stats.indicesSubmitted += indices;
+}
+
+// Queries and object creation
+
+GLenum GLAD_API_PTR mockGetError() {
+    return GL_NO_ERROR;     // not recorded: glad's debug wrapper calls it after every call
+}
+
+const GLubyte* GLAD_API_PTR mockGetString(GLenum name) {
+    record("glGetString");
+    switch (name) {
+    case GL_VERSION: return (const GLubyte*)"4.6.0 RecordingGL";
+    case GL_VENDOR: return (const GLubyte*)"LotusVale";
+    case GL_RENDERER: return (const GLubyte*)"RecordingGL";
+    case GL_SHADING_LANGUAGE_VERSION: return (const GLubyte*)"4.60";
+    default: return (const GLubyte*)"";
+    }
+}
+
+const GLubyte* GLAD_API_PTR mockGetStringi(GLenum, GLuint) {
+    record("glGetStringi");
+    return (const GLubyte*)"";
+}
+
+void GLAD_API_PTR mockGetIntegerv(GLenum pname, GLint* data) {
+    record("glGetIntegerv");
+    switch (pname) {
+    case GL_MAJOR_VERSION: *data = 4; break;
+    case GL_MINOR_VERSION: *data = 6; break;
+    case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT: *data = 256; break;
+    default: *data = 0; break;
+    }
+}
+
+void GLAD_API_PTR mockGenBuffers(GLsizei n, GLuint* names) {
+    record("glGenBuffers");
+    genNames(n, names);
+    for (GLsizei i = 0; i < n; ++i)
+        st().buffers[names[i]];
+}
+
+void GLAD_API_PTR mockGenVertexArrays(GLsizei n, GLuint* names) {
+    record("glGenVertexArrays");
+    genNames(n, names);
+}
+
+void GLAD_API_PTR mockGenTextures(GLsizei n, GLuint* names) {
+    record("glGenTextures");
+    genNames(n, names);
+}
+
+void GLAD_API_PTR mockGenFramebuffers(GLsizei n, GLuint* names) {
+    record("glGenFramebuffers");
+    genNames(n, names);
+}
+
+void GLAD_API_PTR mockGenRenderbuffers(GLsizei n, GLuint* names) {
+    record("glGenRenderbuffers");
+    genNames(n, names);
+}
+
+void GLAD_API_PTR mockDeleteBuffers(GLsizei n, const GLuint* names) {
+    record("glDeleteBuffers");
+    for (GLsizei i = 0; i < n; ++i)
+        st().buffers.erase(names[i]);
+}
+
+void GLAD_API_PTR mockDeleteVertexArrays(GLsizei, const GLuint*) { record("glDeleteVertexArrays"); }
+void GLAD_API_PTR mockDeleteTextures(GLsizei, const GLuint*) { record("glDeleteTextures"); }
+void GLAD_API_PTR mockDeleteFramebuffers(GLsizei, const GLuint*) { record("glDeleteFramebuffers"); }
+void GLAD_API_PTR mockDeleteRenderbuffers(GLsizei, const GLuint*) { record("glDeleteRenderbuffers"); }
+
+GLenum GLAD_API_PTR mockCheckFramebufferStatus(GLenum) {
+    record("glCheckFramebufferStatus");
+    return GL_FRAMEBUFFER_COMPLETE;
+}
+
+// Shaders and programs: everything compiles and links
+
+GLuint GLAD_API_PTR mockCreateShader(GLenum) {
+    record("glCreateShader");
+    ++rec().stats.objectsCreated;
+    return st().nextName++;
+}
+
+GLuint GLAD_API_PTR mockCreateProgram() {
+    record("glCreateProgram");
+    ++rec().stats.objectsCreated;
+    return st().nextName++;
+}
+
+void GLAD_API_PTR mockShaderSource(GLuint, GLsizei, const GLchar* const*, const GLint*) { record("glShaderSource"); }
+void GLAD_API_PTR mockCompileShader(GLuint) { record("glCompileShader"); }
+void GLAD_API_PTR mockAttachShader(GLuint, GLuint) { record("glAttachShader"); }
+void GLAD_API_PTR mockDetachShader(GLuint, GLuint) { record("glDetachShader"); }
+void GLAD_API_PTR mockLinkProgram(GLuint) { record("glLinkProgram"); }
+void GLAD_API_PTR mockDeleteShader(GLuint) { record("glDeleteShader"); }
+void GLAD_API_PTR mockDeleteProgram(GLuint) { record("glDeleteProgram"); }
+void GLAD_API_PTR mockProgramParameteri(GLuint, GLenum, GLint) { record("glProgramParameteri"); }
+void GLAD_API_PTR mockProgramBinary(GLuint, GLenum, const void*, GLsizei) { record("glProgramBinary"); }
+void GLAD_API_PTR mockGetProgramBinary(GLuint, GLsizei, GLsizei* length, GLenum* format, void*) {
+    record("glGetProgramBinary");
+    if (length)
+        *length = 0;
+    *format = 0;
+}
+void GLAD_API_PTR mockMaxShaderCompilerThreads(GLuint) { record("glMaxShaderCompilerThreads"); }
+
+void GLAD_API_PTR mockGetShaderiv(GLuint, GLenum pname, GLint* params) {
+    record("glGetShaderiv");
+    *params = (pname == GL_COMPILE_STATUS) ? GL_TRUE : 0;
+}
+
+void GLAD_API_PTR mockGetProgramiv(GLuint, GLenum pname, GLint* params) {
+    record("glGetProgramiv");
+    *params = (pname == GL_LINK_STATUS || pname == GL_COMPLETION_STATUS_KHR) ? GL_TRUE : 0;
+}
+
+void GLAD_API_PTR mockGetShaderInfoLog(GLuint, GLsizei bufSize, GLsizei* length, GLchar* log) {
+    record("glGetShaderInfoLog");
+    if (bufSize > 0)
+        log[0] = 0;
+    if (length)
+        *length = 0;
+}
+
+void GLAD_API_PTR mockGetProgramInfoLog(GLuint, GLsizei bufSize, GLsizei* length, GLchar* log) {
+    record("glGetProgramInfoLog");
+    if (bufSize > 0)
+        log[0] = 0;
+    if (length)
+        *length = 0;
+}
+
+GLint GLAD_API_PTR mockGetUniformLocation(GLuint, const GLchar*) {
+    record("glGetUniformLocation");
+    return 0;
+}
+
+GLuint GLAD_API_PTR mockGetUniformBlockIndex(GLuint, const GLchar*) {
+    record("glGetUniformBlockIndex");
+    return 0;
+}
+
+void GLAD_API_PTR mockUniformBlockBinding(GLuint, GLuint, GLuint) { record("glUniformBlockBinding"); }
+void GLAD_API_PTR mockUniform1i(GLint, GLint) { uniformUpdate("glUniform1i"); }
+
+// State
+
+void GLAD_API_PTR mockBindBuffer(GLenum target, GLuint buffer) {
+    stateChange("glBindBuffer");
+    binding(target) = buffer;
+}
+
+void GLAD_API_PTR mockBindBufferRange(GLenum, GLuint, GLuint, GLintptr, GLsizeiptr) { stateChange("glBindBufferRange"); }
+
+void GLAD_API_PTR mockBindVertexArray(GLuint vao) {
+    stateChange("glBindVertexArray");
+    st().vao = vao;
+}
+
+void GLAD_API_PTR mockUseProgram(GLuint) { stateChange("glUseProgram"); }
+void GLAD_API_PTR mockBindTexture(GLenum, GLuint) { stateChange("glBindTexture"); }
+void GLAD_API_PTR mockActiveTexture(GLenum) { stateChange("glActiveTexture"); }
+void GLAD_API_PTR mockEnable(GLenum) { stateChange("glEnable"); }
+void GLAD_API_PTR mockDisable(GLenum) { stateChange("glDisable"); }
+void GLAD_API_PTR mockBindFramebuffer(GLenum, GLuint) { stateChange("glBindFramebuffer"); }
+void GLAD_API_PTR mockBindRenderbuffer(GLenum, GLuint) { stateChange("glBindRenderbuffer"); }
+void GLAD_API_PTR mockViewport(GLint, GLint, GLsizei, GLsizei) { stateChange("glViewport"); }
+void GLAD_API_PTR mockPixelStorei(GLenum, GLint) { stateChange("glPixelStorei"); }
+void GLAD_API_PTR mockClearColor(GLfloat, GLfloat, GLfloat, GLfloat) { stateChange("glClearColor"); }
+void GLAD_API_PTR mockEnableVertexAttribArray(GLuint) { record("glEnableVertexAttribArray"); }
+void GLAD_API_PTR mockVertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*) { record("glVertexAttribPointer"); }
+void GLAD_API_PTR mockVertexAttribDivisor(GLuint, GLuint) { record("glVertexAttribDivisor"); }
+void GLAD_API_PTR mockTexParameteri(GLenum, GLenum, GLint) { record("glTexParameteri"); }
+void GLAD_API_PTR mockFramebufferRenderbuffer(GLenum, GLenum, GLenum, GLuint) { record("glFramebufferRenderbuffer"); }
+void GLAD_API_PTR mockRenderbufferStorage(GLenum, GLenum, GLsizei, GLsizei) { record("glRenderbufferStorage"); }
+
+// Data
+
+void GLAD_API_PTR mockBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum) {
+    record("glBufferData");
+    if (auto* s = boundStorage(target)) {
+        s->assign((size_t)size, 0);
+        if (data)
+            std::memcpy(s->data(), data, (size_t)size);
+    }
+    if (data)
+        rec().stats.bytesUploaded += (size_t)size;
+}
+
+void GLAD_API_PTR mockBufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield) {
+    record("glBufferStorage");
+    if (auto* s = boundStorage(target)) {
+        s->assign((size_t)size, 0);
+        if (data)
+            std::memcpy(s->data(), data, (size_t)size);
+    }
+    if (data)
+        rec().stats.bytesUploaded += (size_t)size;
+}
+
+void GLAD_API_PTR mockBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+    record("glBufferSubData");
+    auto* s = boundStorage(target);
+    if (s && (size_t)(offset + size) <= s->size())
+        std::memcpy(s->data() + offset, data, (size_t)size);
+    rec().stats.bytesUploaded += (size_t)size;
+}
+
+void GLAD_API_PTR mockCopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size) {
+    record("glCopyBufferSubData");
+    auto* src = boundStorage(readTarget);
+    auto* dst = boundStorage(writeTarget);
+    if (src && dst && (size_t)(readOffset + size) <= src->size() && (size_t)(writeOffset + size) <= dst->size())
+        std::memmove(dst->data() + writeOffset, src->data() + readOffset, (size_t)size);
+    rec().stats.bytesCopied += (size_t)size;
+}
+
+void* GLAD_API_PTR mockMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+    record("glMapBufferRange");
+    auto* s = boundStorage(target);
+    if (!s || (size_t)(offset + length) > s->size())
+        return nullptr;
+    if (access & GL_MAP_WRITE_BIT)
+        rec().stats.bytesMapped += (size_t)length;
+    return s->data() + offset;
+}
+
+GLboolean GLAD_API_PTR mockUnmapBuffer(GLenum) {
+    record("glUnmapBuffer");
+    return GL_TRUE;
+}
+
+void GLAD_API_PTR mockTexImage2D(GLenum, GLint, GLint, GLsizei w, GLsizei h, GLint, GLenum format, GLenum type, const void* data) {
+    record("glTexImage2D");
+    if (data)
+        rec().stats.bytesUploaded += size_t(w) * h * texelBytes(format, type);
+}
+
+void GLAD_API_PTR mockTexImage3D(GLenum, GLint, GLint, GLsizei w, GLsizei h, GLsizei d, GLint, GLenum format, GLenum type, const void* data) {
+    record("glTexImage3D");
+    if (data)
+        rec().stats.bytesUploaded += size_t(w) * h * d * texelBytes(format, type);
+}
+
+void GLAD_API_PTR mockTexSubImage3D(GLenum, GLint, GLint, GLint, GLint, GLsizei w, GLsizei h, GLsizei d, GLenum format, GLenum type, const void*) {
+    record("glTexSubImage3D");
+    rec().stats.bytesUploaded += size_t(w) * h * d * texelBytes(format, type);
+}
+
+void GLAD_API_PTR mockReadPixels(GLint, GLint, GLsizei w, GLsizei h, GLenum format, GLenum type, void* pixels) {
+    record("glReadPixels");
+    std::memset(pixels, 0, size_t(w) * h * texelBytes(format, type));
+}
+
+// Sync
+
+GLsync GLAD_API_PTR mockFenceSync(GLenum, GLbitfield) {
+    record("glFenceSync");
+    return (GLsync)st().nextSync++;
+}
+
+GLenum GLAD_API_PTR mockClientWaitSync(GLsync, GLbitfield, GLuint64) {
+    record("glClientWaitSync");
+    return GL_ALREADY_SIGNALED;
+}
+
+void GLAD_API_PTR mockDeleteSync(GLsync) { record("glDeleteSync"); }
+
+// Timer queries: every zone takes no time
+
+void GLAD_API_PTR mockGenQueries(GLsizei n, GLuint* names) {
+    record("glGenQueries");
+    genNames(n, names);
+}
+
+void GLAD_API_PTR mockDeleteQueries(GLsizei, const GLuint*) { record("glDeleteQueries"); }
+void GLAD_API_PTR mockBeginQuery(GLenum, GLuint) { record("glBeginQuery"); }
+void GLAD_API_PTR mockEndQuery(GLenum) { record("glEndQuery"); }
+
+void GLAD_API_PTR mockGetQueryObjectui64v(GLuint, GLenum, GLuint64* params) {
+    record("glGetQueryObjectui64v");
+    *params = 0;
+}
+void GLAD_API_PTR mockFinish() { record("glFinish"); }
+
+// Draws
+
+void GLAD_API_PTR mockClear(GLbitfield) { record("glClear"); }
+
+void GLAD_API_PTR mockDrawElements(GLenum, GLsizei count, GLenum, const void*) {
+    draw("glDrawElements", (size_t)count);
+}
+
+void GLAD_API_PTR mockDrawElementsInstanced(GLenum, GLsizei count, GLenum, const void*, GLsizei instances) {
+    draw("glDrawElementsInstanced", size_t(count) * instances);
+}
+
+void GLAD_API_PTR mockDrawElementsBaseVertex(GLenum, GLsizei count, GLenum, const void*, GLint) {
+    draw("glDrawElementsBaseVertex", (size_t)count);
+}
+
+void GLAD_API_PTR mockMultiDrawElementsBaseVertex(GLenum, const GLsizei* count, GLenum, const void* const*, GLsizei drawcount, const GLint*) {
+    size_t indices = 0;
+    for (GLsizei i = 0; i < drawcount; ++i)
+        indices += (size_t)count[i];
+    draw("glMultiDrawElementsBaseVertex", indices);
+}
+
+void GLAD_API_PTR mockMultiDrawElementsIndirect(GLenum, GLenum, const void* indirect, GLsizei drawcount, GLsizei stride) {
+    // Commands are read back from the bound indirect buffer's storage
+    size_t indices = 0;
+    auto* s = boundStorage(GL_DRAW_INDIRECT_BUFFER);
+    const size_t step = stride ? (size_t)stride : 5 * sizeof(GLuint);
+    for (GLsizei i = 0; s && i < drawcount; ++i) {
+        size_t at = (size_t)indirect + i * step;
+        if (at + 2 * sizeof(GLuint) > s->size())
+            break;
+        GLuint cmd[2];
+        std::memcpy(cmd, s->data() + at, sizeof(cmd));
+        indices += size_t(cmd[0]) * cmd[1];
+    }
+    draw("glMultiDrawElementsIndirect", indices);
+}
+
+}
+
+bool RecordingGL::install() {
+    return gladLoadGL(getProcAddress) != 0;
+}
+
+GLADapiproc RecordingGL::getProcAddress(const char* name) {
+    static const std::unordered_map<std::string, GLADapiproc> table = {
+#define STUB(glName, fn) { glName, (GLADapiproc)fn }
+        STUB("glGetError", mockGetError),
+        STUB("glGetString", mockGetString),
+        STUB("glGetStringi", mockGetStringi),
+        STUB("glGetIntegerv", mockGetIntegerv),
+        STUB("glGenBuffers", mockGenBuffers),
+        STUB("glGenVertexArrays", mockGenVertexArrays),
+        STUB("glGenTextures", mockGenTextures),
+        STUB("glGenFramebuffers", mockGenFramebuffers),
+        STUB("glGenRenderbuffers", mockGenRenderbuffers),
+        STUB("glDeleteBuffers", mockDeleteBuffers),
+        STUB("glDeleteVertexArrays", mockDeleteVertexArrays),
+        STUB("glDeleteTextures", mockDeleteTextures),
+        STUB("glDeleteFramebuffers", mockDeleteFramebuffers),
+        STUB("glDeleteRenderbuffers", mockDeleteRenderbuffers),
+        STUB("glCheckFramebufferStatus", mockCheckFramebufferStatus),
+        STUB("glCreateShader", mockCreateShader),
+        STUB("glCreateProgram", mockCreateProgram),
+        STUB("glShaderSource", mockShaderSource),
+        STUB("glCompileShader", mockCompileShader),
+        STUB("glAttachShader", mockAttachShader),
+        STUB("glDetachShader", mockDetachShader),
+        STUB("glLinkProgram", mockLinkProgram),
+        STUB("glDeleteShader", mockDeleteShader),
+        STUB("glDeleteProgram", mockDeleteProgram),
+        STUB("glProgramParameteri", mockProgramParameteri),
+        STUB("glProgramBinary", mockProgramBinary),
+        STUB("glGetProgramBinary", mockGetProgramBinary),
+        STUB("glMaxShaderCompilerThreadsKHR", mockMaxShaderCompilerThreads),
+        STUB("glMaxShaderCompilerThreadsARB", mockMaxShaderCompilerThreads),
+        STUB("glGetShaderiv", mockGetShaderiv),
+        STUB("glGetProgramiv", mockGetProgramiv),
+        STUB("glGetShaderInfoLog", mockGetShaderInfoLog),
+        STUB("glGetProgramInfoLog", mockGetProgramInfoLog),
+        STUB("glGetUniformLocation", mockGetUniformLocation),
+        STUB("glGetUniformBlockIndex", mockGetUniformBlockIndex),
+        STUB("glUniformBlockBinding", mockUniformBlockBinding),
+        STUB("glUniform1i", mockUniform1i),
+        STUB("glBindBuffer", mockBindBuffer),
+        STUB("glBindBufferRange", mockBindBufferRange),
+        STUB("glBindVertexArray", mockBindVertexArray),
+        STUB("glUseProgram", mockUseProgram),
+        STUB("glBindTexture", mockBindTexture),
+        STUB("glActiveTexture", mockActiveTexture),
+        STUB("glEnable", mockEnable),
+        STUB("glDisable", mockDisable),
+        STUB("glBindFramebuffer", mockBindFramebuffer),
+        STUB("glBindRenderbuffer", mockBindRenderbuffer),
+        STUB("glViewport", mockViewport),
+        STUB("glPixelStorei", mockPixelStorei),
+        STUB("glClearColor", mockClearColor),
+        STUB("glEnableVertexAttribArray", mockEnableVertexAttribArray),
+        STUB("glVertexAttribPointer", mockVertexAttribPointer),
+        STUB("glVertexAttribDivisor", mockVertexAttribDivisor),
+        STUB("glTexParameteri", mockTexParameteri),
+        STUB("glFramebufferRenderbuffer", mockFramebufferRenderbuffer),
+        STUB("glRenderbufferStorage", mockRenderbufferStorage),
+        STUB("glBufferData", mockBufferData),
+        STUB("glBufferStorage", mockBufferStorage),
+        STUB("glBufferSubData", mockBufferSubData),
+        STUB("glCopyBufferSubData", mockCopyBufferSubData),
+        STUB("glMapBufferRange", mockMapBufferRange),
+        STUB("glUnmapBuffer", mockUnmapBuffer),
+        STUB("glTexImage2D", mockTexImage2D),
+        STUB("glTexImage3D", mockTexImage3D),
+        STUB("glTexSubImage3D", mockTexSubImage3D),
+        STUB("glReadPixels", mockReadPixels),
+        STUB("glFenceSync", mockFenceSync),
+        STUB("glClientWaitSync", mockClientWaitSync),
+        STUB("glDeleteSync", mockDeleteSync),
+        STUB("glGenQueries", mockGenQueries),
+        STUB("glDeleteQueries", mockDeleteQueries),
+        STUB("glBeginQuery", mockBeginQuery),
+        STUB("glEndQuery", mockEndQuery),
+        STUB("glGetQueryObjectui64v", mockGetQueryObjectui64v),
+        STUB("glFinish", mockFinish),
+        STUB("glClear", mockClear),
+        STUB("glDrawElements", mockDrawElements),
+        STUB("glDrawElementsInstanced", mockDrawElementsInstanced),
+        STUB("glDrawElementsBaseVertex", mockDrawElementsBaseVertex),
+        STUB("glMultiDrawElementsBaseVertex", mockMultiDrawElementsBaseVertex),
+        STUB("glMultiDrawElementsIndirect", mockMultiDrawElementsIndirect),
+#undef STUB
+    };
+    auto it = table.find(name);
+    return it == table.end() ? nullptr : it->second;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <glad/gl.h>
+#include <cstddef>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct GLRecordStats {
+    size_t calls = 0;
+    size_t drawCalls = 0;           // a multi-draw counts once
+    size_t indicesSubmitted = 0;    // including every indirect command and instance
+    size_t stateChanges = 0;        // binds, enables, viewport, pixel store
+    size_t uniformUpdates = 0;
+    size_t bytesUploaded = 0;       // buffer and texture data sent from client memory
+    size_t bytesCopied = 0;         // glCopyBufferSubData
+    size_t bytesMapped = 0;         // writable glMapBufferRange ranges
+    size_t objectsCreated = 0;
+};
+
+// A GL "driver" that records instead of rendering. install() loads glad with
+// stubs for every entry point the renderer uses, so the normal code paths
+// run without a context: buffers get real client-side storage (mapping
+// works), status queries report success, and each call is logged and
+// counted. Entry points without a stub stay NULL, and glad's debug wrapper
+// names them if they're ever called.
+//
+// The recorder reports as GL 4.6 with no extensions, so the GL 4.4+ paths
+// (persistent mapping, multi-draw-indirect) are the ones exercised.
+class RecordingGL {
+public:
+    GLRecordStats stats;
+    bool keepCommands = false;      // log call names in order, not just counts
+    std::vector<const char*> commands;
+    // Keyed by the stubs' literal names; entries survive reset() at zero, so
+    // recording a frame doesn't allocate once every call has been seen
+    std::unordered_map<std::string_view, size_t> callCounts;
+
+    static RecordingGL& instance();
+
+    bool install();
+    static GLADapiproc getProcAddress(const char* name);
+
+    // Clears stats and logs; objects and bindings are kept
+    void reset();
+    size_t count(const char* name) const;
+
+    // Recorder-side object state, used by the stubs
+    struct State;
+    State& state();
+
+private:
+    RecordingGL() = default;
+};
@@ -0,0 +1,26 @@
+#include "RenderQueue.h"
+#include <algorithm>
+
+uint64_t makeSortKey(GLuint program, GLuint vao, GLuint texture, float depth01) {
+    uint64_t depth = (uint64_t)(std::clamp(depth01, 0.0f, 1.0f) * 65535.0f);
+    return (uint64_t(program & 0xFFFF) << 48)
+        | (uint64_t(vao & 0xFFFF) << 32)
+        | (uint64_t(texture & 0xFFFF) << 16)
+        | depth;
+}
+
+void RenderQueue::execute(GLStateCache& state) {
+    // Equal keys keep push order; std::stable_sort would allocate a buffer
+    std::sort(items.begin(), items.end(), [](const RenderItem& a, const RenderItem& b) {
+        return a.key != b.key ? a.key < b.key : a.sequence < b.sequence;
+    });
+
+    for (const RenderItem& item : items) {
+        state.setDepthTest(item.depthTest);
+        state.useProgram(item.program);
+        state.bindVertexArray(item.vao);
+        if (item.texture)
+            state.bindTexture(0, item.textureTarget, item.texture);
+        item.draw(item.context);
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "GLStateCache.h"
+#include "FrameArena.h"
+#include <cstdint>
+#include <vector>
+
+// 64-bit sort key, most significant first: program, VAO, texture, then view
+// depth quantized front to back. GL names are truncated to 16 bits, which
+// can only cost sort quality: the state applied comes from the item itself.
+uint64_t makeSortKey(GLuint program, GLuint vao, GLuint texture, float depth01);
+
+struct RenderItem {
+    uint64_t key = 0;
+    GLuint program = 0;
+    GLuint vao = 0;
+    GLenum textureTarget = GL_TEXTURE_2D;
+    GLuint texture = 0;
+    bool depthTest = true;
+    // Issues uniforms and draw calls only; context lives in the frame arena
+    void (*draw)(const void* context) = nullptr;
+    const void* context = nullptr;
+    uint32_t sequence = 0;        // push order, breaks key ties
+};
+
+// Collects the frame's draws, sorts them by key and applies the shared
+// state through a GLStateCache, so consecutive items with the same program,
+// VAO or texture don't rebind them. Draw callbacks are copied into a
+// FrameArena, and the item storage keeps its capacity across clear(), so a
+// steady-state frame queues without allocating.
+class RenderQueue {
+public:
+    void clear() { items.clear(); }
+
+    void push(RenderItem item) {
+        item.sequence = (uint32_t)items.size();
+        items.push_back(item);
+    }
+
+    // The callable must stay valid until execute(), so capture by reference
+    // only things that outlive the frame
+    template <typename F>
+    void push(RenderItem item, FrameArena& arena, F draw) {
+        item.context = arena.create<F>(std::move(draw));
+        item.draw = [](const void* context) { (*static_cast<const F*>(context))(); };
+        push(item);
+    }
+    size_t size() const { return items.size(); }
+
+    void execute(GLStateCache& state);
+
+private:
+    std::vector<RenderItem> items;
+};
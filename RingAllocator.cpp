@@ -0,0 +1,80 @@
+#include "RingAllocator.h"
+
+RingAllocator::RingAllocator(size_t capacity, FenceBackend& fences)
+    : capacity(capacity), fences(fences), inFlight(MAX_FRAMES_IN_FLIGHT) {
+}
+
+RingAllocator::~RingAllocator() {
+    while (inFlightCount > 0)
+        retireOldest();
+}
+
+void RingAllocator::retireOldest() {
+    fences.release(oldest().fence);
+    inFlightFirst = (inFlightFirst + 1) % MAX_FRAMES_IN_FLIGHT;
+    --inFlightCount;
+}
+
+void RingAllocator::beginFrame() {
+    while (inFlightCount > 0 && fences.isSignaled(oldest().fence))
+        retireOldest();
+    frameBytes = 0;
+}
+
+bool RingAllocator::allocate(size_t size, size_t alignment, RingAllocation& out) {
+    if (size == 0 || size > capacity) {
+        ++failedAllocations;
+        return false;
+    }
+
+    uint64_t v = head;
+    size_t p = size_t(v % capacity);
+    size_t aligned = alignment > 1 ? (p + alignment - 1) / alignment * alignment : p;
+    v += aligned - p;
+    p = aligned;
+
+    bool wrapped = false;
+    if (p + size > capacity) {
+        // Skip the tail of the ring; the padding stays part of this frame
+        v += capacity - p;
+        p = 0;
+        wrapped = true;
+    }
+
+    for (;;) {
+        uint64_t oldestBegin = inFlightCount == 0 ? frameBegin : oldest().begin;
+        if (v + size - oldestBegin <= capacity)
+            break;
+        if (inFlightCount == 0) {
+            ++failedAllocations;
+            return false;
+        }
+        fences.wait(oldest().fence);
+        retireOldest();
+        ++fenceWaits;
+    }
+
+    head = v + size;
+    frameBytes += size;
+    out = { p, size, wrapped };
+    return true;
+}
+
+void RingAllocator::restart() {
+    uint64_t p = head % capacity;
+    if (p != 0)
+        head += capacity - p;
+    frameBegin = head;
+}
+
+void RingAllocator::endFrame() {
+    if (head == frameBegin)
+        return;
+    if (inFlightCount == MAX_FRAMES_IN_FLIGHT) {
+        fences.wait(oldest().fence);
+        retireOldest();
+        ++fenceWaits;
+    }
+    inFlight[(inFlightFirst + inFlightCount++) % MAX_FRAMES_IN_FLIGHT] = { frameBegin, head, fences.insert() };
+    frameBegin = head;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Opaque GPU fence operations, so the ring logic can be driven without a
+// driver. Handles are whatever the backend wants them to be.
+class FenceBackend {
+public:
+    virtual ~FenceBackend() = default;
+    virtual uint64_t insert() = 0;
+    virtual bool isSignaled(uint64_t fence) = 0;
+    virtual void wait(uint64_t fence) = 0;
+    virtual void release(uint64_t fence) = 0;
+};
+
+struct RingAllocation {
+    size_t offset;
+    size_t size;
+    bool wrapped;   // allocation restarted at offset 0
+};
+
+// Per-frame sub-allocator over a fixed-size ring. Offsets grow through a
+// 64-bit virtual address space and are mapped onto the ring modulo its
+// capacity. Every frame's range is fenced at endFrame(); an allocation that
+// would overwrite a range still in flight waits for that frame's fence, as
+// does ending a frame while MAX_FRAMES_IN_FLIGHT are already queued.
+class RingAllocator {
+public:
+    static const size_t MAX_FRAMES_IN_FLIGHT = 16;
+
+    size_t capacity;
+
+    // Stats
+    size_t frameBytes = 0;
+    size_t fenceWaits = 0;
+    size_t failedAllocations = 0;
+
+    RingAllocator(size_t capacity, FenceBackend& fences);
+    ~RingAllocator();
+
+    RingAllocator(const RingAllocator&) = delete;
+    RingAllocator& operator=(const RingAllocator&) = delete;
+
+    // Retires frames whose fences have already signaled, without blocking
+    void beginFrame();
+
+    // Fails only if the current frame alone would exceed the capacity
+    bool allocate(size_t size, size_t alignment, RingAllocation& out);
+
+    void endFrame();
+
+    // Restarts allocation at offset 0 of the next lap. Only valid between
+    // endFrame() and the next frame's first allocation.
+    void restart();
+
+    size_t inFlightFrames() const { return inFlightCount; }
+
+private:
+    struct Frame {
+        uint64_t begin, end;
+        uint64_t fence;
+    };
+
+    FenceBackend& fences;
+    // Fixed ring of fenced frames, oldest at inFlightFirst
+    std::vector<Frame> inFlight;
+    size_t inFlightFirst = 0;
+    size_t inFlightCount = 0;
+    uint64_t head = 0;
+    uint64_t frameBegin = 0;
+
+    const Frame& oldest() const { return inFlight[inFlightFirst]; }
+    void retireOldest();
+};
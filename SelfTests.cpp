@@ -0,0 +1,303 @@
+#include "SelfTests.h"
+#include "GeometryClipmap.h"
+#include "RingAllocator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+// CPU copy of a clipmap's level textures, filled from its pending uploads
+struct ClipmapTextures {
+    int ringSize;
+    std::vector<std::vector<float>> levels;
+
+    ClipmapTextures(const GeometryClipmap& clipmap)
+        : ringSize(clipmap.ringSize),
+        levels(clipmap.levelCount, std::vector<float>(size_t(clipmap.ringSize) * clipmap.ringSize, 0.0f)) {
+    }
+
+    void apply(const GeometryClipmap& clipmap) {
+        for (const ClipmapUpload& up : clipmap.pendingUploads) {
+            for (int r = 0; r < up.h; ++r) {
+                const float* src = &clipmap.staging[up.dataOffset + size_t(r) * up.w];
+                std::copy(src, src + up.w, &levels[up.level][size_t(up.texZ + r) * ringSize + up.texX]);
+            }
+        }
+    }
+};
+
+float clipmapHeight(int x, int z) {
+    return std::sin(x * 0.013f) * 40.0f + std::cos(z * 0.021f) * 25.0f + float((x * 7 + z * 13) & 15);
+}
+
+// Checks the uploads of one update() against the window each level moved
+// from: every texel sampled at most once, with the height of the sample it
+// now holds, and a level that scrolled gets exactly the newly exposed L.
+// Returns the number of texels that break this.
+size_t checkClipmapUploads(const GeometryClipmap& clipmap, const std::vector<ClipmapLevel>& before) {
+    const int n = clipmap.ringSize;
+    size_t errors = 0;
+    std::vector<int> covered(size_t(n) * n);
+    for (int level = 0; level < clipmap.levelCount; ++level) {
+        const ClipmapLevel& now = clipmap.levels[level];
+        const ClipmapLevel& was = before[level];
+        std::fill(covered.begin(), covered.end(), 0);
+        for (const ClipmapUpload& up : clipmap.pendingUploads) {
+            if (up.level != level)
+                continue;
+            for (int r = 0; r < up.h; ++r) {
+                for (int c = 0; c < up.w; ++c) {
+                    int tx = up.texX + c, tz = up.texZ + r;
+                    ++covered[size_t(tz) * n + tx];
+                    int x = now.originX + GeometryClipmap::wrap(tx - now.originX, n);
+                    int z = now.originZ + GeometryClipmap::wrap(tz - now.originZ, n);
+                    errors += clipmap.staging[up.dataOffset + size_t(r) * up.w + c] != clipmapHeight(x << level, z << level);
+                }
+            }
+        }
+
+        bool scrolled = was.valid && std::abs(now.originX - was.originX) < n && std::abs(now.originZ - was.originZ) < n;
+        for (int tz = 0; tz < n; ++tz) {
+            for (int tx = 0; tx < n; ++tx) {
+                int count = covered[size_t(tz) * n + tx];
+                if (!scrolled) {
+                    errors += count > 1;
+                    continue;
+                }
+                int x = now.originX + GeometryClipmap::wrap(tx - now.originX, n);
+                int z = now.originZ + GeometryClipmap::wrap(tz - now.originZ, n);
+                bool exposed = x < was.originX || x >= was.originX + n || z < was.originZ || z >= was.originZ + n;
+                errors += count != (exposed ? 1 : 0);
+            }
+        }
+    }
+    return errors;
+}
+
+// Drives a clipmap along a scripted camera path and checks every update:
+// only exposed texels are sampled, the budget holds, and once the camera
+// stops the textures are what a fresh clipmap builds in one go
+bool testClipmap() {
+    const int levelCount = 5, ringSize = 64;
+    const size_t budget = 16 * 1024;
+    GeometryClipmap clipmap(clipmapHeight, 1.0f, levelCount, ringSize, budget);
+    ClipmapTextures textures(clipmap);
+    std::cout << "Clipmap: " << levelCount << " levels of " << ringSize << "^2, " << budget / 1024
+        << " KB upload budget, scripted camera\n";
+
+    // Per frame, in samples: settle, walk, walk diagonally, run faster than
+    // the budget keeps up with, jump further than a ring, then stand still
+    struct Leg { int frames; float dx, dz; };
+    const Leg path[] = {
+        { 60, 0.0f, 0.0f }, { 200, 0.7f, 0.0f }, { 200, -0.9f, 1.3f }, { 40, 37.0f, -23.0f },
+        { 1, 5000.0f, 3000.0f }, { 300, 0.0f, 0.0f },
+    };
+    glm::vec3 camera(1000.0f, 0.0f, 1000.0f);
+    std::vector<ClipmapLevel> before;
+    size_t badTexels = 0, overBudget = 0, misreported = 0;
+    int frames = 0;
+    for (const Leg& leg : path) {
+        for (int f = 0; f < leg.frames; ++f, ++frames) {
+            camera.x += leg.dx;
+            camera.z += leg.dz;
+            before = clipmap.levels;
+            clipmap.update(camera);
+
+            size_t bytes = clipmap.staging.size() * sizeof(float);
+            overBudget += bytes > budget;
+            misreported += bytes != clipmap.lastUploadBytes;
+            badTexels += checkClipmapUploads(clipmap, before);
+            textures.apply(clipmap);
+        }
+    }
+
+    // The same camera from scratch, with budget enough to fill every level at once
+    GeometryClipmap fresh(clipmapHeight, 1.0f, levelCount, ringSize, size_t(levelCount) * ringSize * ringSize * sizeof(float));
+    ClipmapTextures freshTextures(fresh);
+    fresh.update(camera);
+    freshTextures.apply(fresh);
+    size_t mismatched = 0;
+    for (int level = 0; level < levelCount; ++level) {
+        const ClipmapLevel& a = clipmap.levels[level];
+        const ClipmapLevel& b = fresh.levels[level];
+        mismatched += !a.active || !b.active || a.originX != b.originX || a.originZ != b.originZ
+            || textures.levels[level] != freshTextures.levels[level];
+    }
+
+    std::cout << "  " << frames << " updates: " << badTexels << " texels sampled outside the exposed strips or wrong, " << overBudget
+        << " frames over budget, " << misreported << " misreported, " << mismatched
+        << " levels differing from a fresh build\n";
+    bool ok = badTexels == 0 && overBudget == 0 && misreported == 0 && mismatched == 0;
+    if (!ok)
+        std::cout << "  CHECK FAILED\n";
+    return ok;
+}
+
+
+// A GPU that finishes fences in order, as far as the test lets it: a fence
+// is signaled once completed reaches it, and waiting on one finishes it
+struct FakeFences : FenceBackend {
+    uint64_t inserted = 0, completed = 0;
+    std::vector<uint64_t> waited;
+    std::vector<uint8_t> released;  // per fence, from 1
+    size_t badReleases = 0;
+
+    uint64_t insert() override {
+        released.push_back(0);
+        return ++inserted;
+    }
+    bool isSignaled(uint64_t fence) override { return fence <= completed; }
+    void wait(uint64_t fence) override {
+        waited.push_back(fence);
+        completed = std::max(completed, fence);
+    }
+    void release(uint64_t fence) override {
+        if (fence == 0 || fence > inserted || released[fence - 1])
+            ++badReleases;
+        else
+            released[fence - 1] = 1;
+    }
+    void advance(uint64_t fences) { completed = std::min(inserted, completed + fences); }
+};
+
+// Fixed cases: wrapping to offset 0, the wait once MAX_FRAMES_IN_FLIGHT are
+// queued, and restart() waiting only for what its next lap overlaps.
+// Returns the number of cases that fail.
+size_t checkRingCases() {
+    size_t failed = 0;
+    {
+        FakeFences gpu;
+        RingAllocator ring(1000, gpu);
+        const size_t expected[] = { 0, 300, 600, 0 };
+        for (size_t i = 0; i < 4; ++i) {
+            ring.beginFrame();
+            RingAllocation a;
+            failed += !ring.allocate(300, 1, a) || a.offset != expected[i] || a.wrapped != (i == 3);
+            ring.endFrame();
+            gpu.advance(1);
+        }
+        failed += ring.fenceWaits != 0;
+    }
+    {
+        FakeFences gpu;
+        RingAllocator ring(4096, gpu);
+        for (size_t i = 0; i <= RingAllocator::MAX_FRAMES_IN_FLIGHT; ++i) {
+            ring.beginFrame();
+            RingAllocation a;
+            failed += !ring.allocate(16, 16, a);
+            ring.endFrame();
+        }
+        failed += ring.fenceWaits != 1 || gpu.waited.size() != 1 || gpu.waited[0] != 1
+            || ring.inFlightFrames() != RingAllocator::MAX_FRAMES_IN_FLIGHT;
+    }
+    {
+        FakeFences gpu;
+        RingAllocator ring(1000, gpu);
+        RingAllocation a;
+        ring.beginFrame();
+        failed += !ring.allocate(100, 1, a);
+        ring.endFrame();
+        ring.restart();
+        ring.beginFrame();
+        failed += !ring.allocate(50, 1, a) || a.offset != 0 || ring.fenceWaits != 1;
+        ring.endFrame();
+        ring.restart();
+        gpu.advance(2);
+        ring.beginFrame();
+        failed += !ring.allocate(50, 1, a) || a.offset != 0 || ring.fenceWaits != 1;
+        ring.endFrame();
+    }
+    return failed;
+}
+
+// Random frames against a GPU that lags, stalls and catches up, with the
+// ring's bytes shadowed by the frame that last wrote them. A frame may only
+// write bytes whose last writer's fence has finished, and every fence is
+// released exactly once. Returns the number of allocations that break this.
+bool testRing() {
+    const size_t capacity = 4096;
+    const int frames = 5000;
+    std::cout << "Ring allocator: " << capacity << " B, " << frames << " random frames\n";
+
+    size_t caseFailures = checkRingCases();
+    FakeFences gpu;
+    std::vector<int> owner(capacity, 0);    // frame that last wrote each byte, from 1
+    std::vector<uint64_t> fenceOf(frames + 1, 0);
+    size_t allocations = 0, wrapped = 0, restarts = 0, overwrites = 0, misplaced = 0, failures = 0;
+    size_t fenceWaits = 0, maxInFlight = 0;
+    std::mt19937 rng(5);
+    {
+        RingAllocator ring(capacity, gpu);
+        for (int frame = 1; frame <= frames; ++frame) {
+            // Mostly a frame or two behind, with stalls of small frames long
+            // enough to fill every in-flight slot
+            const bool stalled = (frame / 200) % 4 == 3;
+            const size_t maxSize = stalled ? 16 : capacity / 20;
+            ring.beginFrame();
+            uint64_t fenceBefore = gpu.inserted;
+            int count = std::uniform_int_distribution<int>(0, 5)(rng);
+            for (int k = 0; k < count; ++k) {
+                size_t size = std::uniform_int_distribution<size_t>(1, maxSize)(rng);
+                size_t alignment = size_t(1) << (4 * std::uniform_int_distribution<int>(0, 2)(rng));
+                RingAllocation a;
+                if (!ring.allocate(size, alignment, a)) {
+                    ++failures;
+                    continue;
+                }
+                ++allocations;
+                wrapped += a.wrapped;
+                misplaced += a.offset % alignment != 0 || a.offset + a.size > capacity || (a.wrapped && a.offset != 0);
+                for (size_t b = a.offset; b < a.offset + a.size; ++b) {
+                    int last = owner[b];
+                    overwrites += last == frame || (last != 0 && fenceOf[last] > gpu.completed);
+                    owner[b] = frame;
+                }
+            }
+            ring.endFrame();
+            if (gpu.inserted != fenceBefore)
+                fenceOf[frame] = gpu.inserted;
+            maxInFlight = std::max(maxInFlight, ring.inFlightFrames());
+            if (std::uniform_int_distribution<int>(0, 15)(rng) == 0) {
+                ring.restart();
+                ++restarts;
+            }
+            gpu.advance(stalled ? 0 : std::uniform_int_distribution<int>(0, 2)(rng));
+        }
+        fenceWaits = ring.fenceWaits;
+    }
+    size_t unreleased = std::count(gpu.released.begin(), gpu.released.end(), 0);
+
+    std::cout << "  " << allocations << " allocations, " << wrapped << " wrapped, " << restarts << " restarts, "
+        << fenceWaits << " fence waits, at most " << maxInFlight << " frames in flight\n"
+        << "  " << overwrites << " overwrote a frame still in flight, " << misplaced << " misplaced, " << failures
+        << " failed, " << unreleased << " fences unreleased, " << gpu.badReleases << " bad releases, "
+        << caseFailures << " fixed cases failed\n";
+    bool ok = overwrites == 0 && misplaced == 0 && failures == 0 && unreleased == 0 && gpu.badReleases == 0
+        && caseFailures == 0 && maxInFlight <= RingAllocator::MAX_FRAMES_IN_FLIGHT;
+    if (!ok)
+        std::cout << "  CHECK FAILED\n";
+    return ok;
+}
+}
+
+bool runSelfTest(const std::string& name) {
+    bool all = name == "all";
+    bool ok = true, known = all;
+    if (all || name == "clipmap") {
+        ok = testClipmap() && ok;
+        known = true;
+    }
+    if (all || name == "ring") {
+        ok = testRing() && ok;
+        known = true;
+    }
+    if (!known) {
+        std::cerr << "Unknown self-test " << name << " (clipmap, ring, or all)\n";
+        return false;
+    }
+    return ok;
+}
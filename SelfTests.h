@@ -0,0 +1,13 @@
+#pragma once
+#include <string>
+
+// Correctness checks that need no GPU and time nothing, so they can run on
+// any machine, run from the command line with --self-test NAME, or all of
+// them with --self-test all. Returns false for an unknown name or a failed
+// check.
+//   clipmap: GeometryClipmap along a scripted camera path, checking each
+//            update's uploads and the final textures against a fresh build
+//   ring: RingAllocator over a fake FenceBackend, checking wrap-around, the
+//         wait once MAX_FRAMES_IN_FLIGHT are queued and restart(), and that
+//         no frame overwrites one the GPU may still be reading
+bool runSelfTest(const std::string& name);
@@ -0,0 +1,8 @@
+#pragma once
+#include <glad/gl.h>
+
+GLuint compileShader(GLenum type, const char* src);
+
+// Compiles and links a vertex/fragment pair. Link errors are reported to
+// std::cerr the same way compile errors are.
+GLuint createProgram(const char* vsSrc, const char* fsSrc);
@@ -0,0 +1,118 @@
+#include "StreamBuffer.h"
+#include <iostream>
+
+namespace {
+
+class GLFenceBackend : public FenceBackend {
+public:
+    uint64_t insert() override {
+        return (uint64_t)(uintptr_t)glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    bool isSignaled(uint64_t fence) override {
+        GLenum r = glClientWaitSync((GLsync)(uintptr_t)fence, 0, 0);
+        return r == GL_ALREADY_SIGNALED || r == GL_CONDITION_SATISFIED;
+    }
+    void wait(uint64_t fence) override {
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        for (;;) {
+            GLenum r = glClientWaitSync((GLsync)(uintptr_t)fence, flags, 1000000);
+            if (r != GL_TIMEOUT_EXPIRED)
+                return;
+            flags = 0;
+        }
+    }
+    void release(uint64_t fence) override {
+        glDeleteSync((GLsync)(uintptr_t)fence);
+    }
+};
+
+// Orphaning gives every frame fresh storage, so nothing ever has to wait
+class OrphanFenceBackend : public FenceBackend {
+public:
+    uint64_t insert() override { return 0; }
+    bool isSignaled(uint64_t) override { return true; }
+    void wait(uint64_t) override {}
+    void release(uint64_t) override {}
+};
+
+}
+
+void StreamBuffer::init(size_t cap) {
+    capacity = cap;
+    persistent = GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    if (persistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, capacity, nullptr, flags);
+        mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, capacity, flags);
+        if (mapped) {
+            fences.reset(new GLFenceBackend());
+        }
+        else {
+            // Storage is immutable, so orphaning needs a fresh buffer
+            std::cerr << "StreamBuffer: persistent map failed, orphaning instead\n";
+            persistent = false;
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        }
+    }
+    if (!persistent) {
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+        fences.reset(new OrphanFenceBackend());
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    ring.reset(new RingAllocator(capacity, *fences));
+}
+
+void StreamBuffer::beginFrame() {
+    ring->beginFrame();
+    if (!persistent) {
+        ring->restart();
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+}
+
+void* StreamBuffer::map(size_t size, size_t alignment, size_t& offset) {
+    RingAllocation a;
+    if (!ring->allocate(size, alignment, a))
+        return nullptr;
+    offset = a.offset;
+
+    if (persistent)
+        return mapped + a.offset;
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    rangeMapped = true;
+    return glMapBufferRange(GL_COPY_WRITE_BUFFER, a.offset, a.size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+void StreamBuffer::unmap() {
+    if (!rangeMapped)
+        return;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    rangeMapped = false;
+}
+
+void StreamBuffer::endFrame() {
+    ring->endFrame();
+}
+
+void StreamBuffer::destroy() {
+    ring.reset();
+    if (persistent && mapped) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    mapped = nullptr;
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+}
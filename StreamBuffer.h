@@ -0,0 +1,36 @@
+#pragma once
+#include "RingAllocator.h"
+#include <glad/gl.h>
+#include <memory>
+
+// Streaming upload buffer. On GL 4.4 (or ARB_buffer_storage) the whole ring
+// is persistently and coherently mapped once, and reuse is guarded by
+// glFenceSync per frame. Older contexts fall back to orphaning: the buffer
+// is re-specified with glBufferData at the start of every frame, and each
+// allocation is mapped unsynchronized. Orphaning only at frame boundaries
+// keeps ranges bound earlier in the frame (uniform blocks) valid; a frame
+// that outgrows the ring gets failed allocations instead of a mid-frame
+// orphan.
+class StreamBuffer {
+public:
+    GLuint buffer = 0;
+    size_t capacity = 0;
+    bool persistent = false;
+    std::unique_ptr<RingAllocator> ring;
+
+    void init(size_t capacity);
+    void beginFrame();
+
+    // CPU pointer for size bytes at byte `offset` in buffer, or nullptr if
+    // the request can't fit this frame. Call unmap() before GL reads it.
+    void* map(size_t size, size_t alignment, size_t& offset);
+    void unmap();
+
+    void endFrame();
+    void destroy();
+
+private:
+    unsigned char* mapped = nullptr;
+    bool rangeMapped = false;
+    std::unique_ptr<FenceBackend> fences;
+};
@@ -0,0 +1,65 @@
+#include "TerrainChunks.h"
+#include <algorithm>
+
+std::vector<TerrainChunk> buildTerrainChunks(const HeightfieldMinMax& minMax, float spacing, int chunkCells) {
+    std::vector<TerrainChunk> chunks;
+    for (int z = 0; z < minMax.cellsH; z += chunkCells) {
+        for (int x = 0; x < minMax.cellsW; x += chunkCells) {
+            TerrainChunk c;
+            c.cellX = x;
+            c.cellZ = z;
+            c.cellsW = std::min(chunkCells, minMax.cellsW - x);
+            c.cellsH = std::min(chunkCells, minMax.cellsH - z);
+
+            float minH, maxH;
+            minMax.rangeMinMax(x, z, x + c.cellsW, z + c.cellsH, minH, maxH);
+            c.boxMin = glm::vec3(x * spacing, minH, z * spacing);
+            c.boxMax = glm::vec3((x + c.cellsW) * spacing, maxH, (z + c.cellsH) * spacing);
+            chunks.push_back(c);
+        }
+    }
+    return chunks;
+}
+
+void buildChunkMesh(const std::vector<std::vector<float>>& heightMap, float spacing, const TerrainChunk& chunk, ChunkMesh& mesh) {
+    mesh.vertices.clear();
+    mesh.indices.clear();
+
+    const int vw = chunk.cellsW + 1;
+    for (int z = 0; z <= chunk.cellsH; ++z) {
+        for (int x = 0; x <= chunk.cellsW; ++x) {
+            int gx = chunk.cellX + x, gz = chunk.cellZ + z;
+            mesh.vertices.push_back(gx * spacing);
+            mesh.vertices.push_back(heightMap[gz][gx]);
+            mesh.vertices.push_back(gz * spacing);
+        }
+    }
+    for (int z = 0; z < chunk.cellsH; ++z) {
+        for (int x = 0; x < chunk.cellsW; ++x) {
+            unsigned int v0 = z * vw + x;
+            unsigned int v1 = v0 + 1;
+            unsigned int v2 = v0 + vw;
+            unsigned int v3 = v2 + 1;
+            mesh.indices.insert(mesh.indices.end(), { v0, v2, v1, v1, v2, v3 });
+        }
+    }
+}
+
+void cullTerrainChunks(const std::vector<TerrainChunk>& chunks, const Frustum& frustum, const OcclusionBuffer* occlusion,
+    std::vector<int>& visible, ChunkCullStats& stats) {
+    visible.clear();
+    stats = ChunkCullStats();
+    for (int i = 0; i < (int)chunks.size(); ++i) {
+        const TerrainChunk& c = chunks[i];
+        if (!frustum.intersectsAABB(c.boxMin, c.boxMax)) {
+            ++stats.frustumCulled;
+            continue;
+        }
+        if (occlusion && !occlusion->testAABB(c.boxMin, c.boxMax)) {
+            ++stats.occlusionCulled;
+            continue;
+        }
+        visible.push_back(i);
+    }
+    stats.visible = visible.size();
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "HeightfieldMinMax.h"
+#include "Frustum.h"
+#include "OcclusionBuffer.h"
+#include <glm.hpp>
+#include <vector>
+
+// A rectangular block of terrain cells drawn as one unit. firstIndex and
+// baseVertex locate its mesh inside the shared chunk buffers.
+struct TerrainChunk {
+    int cellX, cellZ;
+    int cellsW, cellsH;
+    glm::vec3 boxMin, boxMax;
+    unsigned int firstIndex = 0;
+    unsigned int indexCount = 0;
+    int baseVertex = 0;
+};
+
+// CPU mesh for one chunk: xyz positions and chunk-local triangle indices
+struct ChunkMesh {
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+};
+
+// Splits the heightmap into chunkCells x chunkCells blocks with world-space
+// bounds taken from the min/max pyramid.
+std::vector<TerrainChunk> buildTerrainChunks(const HeightfieldMinMax& minMax, float spacing, int chunkCells);
+
+void buildChunkMesh(const std::vector<std::vector<float>>& heightMap, float spacing, const TerrainChunk& chunk, ChunkMesh& mesh);
+
+struct ChunkCullStats {
+    size_t frustumCulled = 0;
+    size_t occlusionCulled = 0;
+    size_t visible = 0;
+};
+
+// Fills visible with the indices of chunks that pass the frustum test and,
+// if an occlusion buffer is given, its depth test.
+void cullTerrainChunks(const std::vector<TerrainChunk>& chunks, const Frustum& frustum, const OcclusionBuffer* occlusion,
+    std::vector<int>& visible, ChunkCullStats& stats);
@@ -0,0 +1,490 @@
+#include "TerrainCollider.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Contacts shallower than this are reported but not pushed out of, so a
+// resting capsule doesn't spend every iteration on rounding error. A capsule
+// within it of the terrain counts as touching.
+const float CONTACT_SLOP = 1e-4f;
+
+// A sweep stops when the capsule is this close to the terrain
+const float SWEEP_TOLERANCE = 1e-3f;
+// Contacts approached slower than this fraction of the displacement are
+// slid along rather than hit; resolve() takes up what little they penetrate
+const float SWEEP_MIN_APPROACH = 1e-3f;
+const int SWEEP_ITERATIONS = 16;
+// How far past a sweep's contact the capsule moves, as a fraction of its
+// radius, so resolve() sees the contact and steps up or slides off it
+const float SWEEP_OVERSHOOT = 0.5f;
+
+// Closest points between segments p1q1 and p2q2 (Ericson, Real-Time
+// Collision Detection 5.1.9). Returns the squared distance.
+float closestSegmentSegment(const glm::vec3& p1, const glm::vec3& q1, const glm::vec3& p2, const glm::vec3& q2,
+    glm::vec3& c1, glm::vec3& c2) {
+    const float EPS = 1e-8f;
+    glm::vec3 d1 = q1 - p1, d2 = q2 - p2, r = p1 - p2;
+    float a = glm::dot(d1, d1), e = glm::dot(d2, d2), f = glm::dot(d2, r);
+    float s = 0.0f, t = 0.0f;
+    if (a <= EPS && e <= EPS) {
+        // Both degenerate to points
+    }
+    else if (a <= EPS) {
+        t = std::clamp(f / e, 0.0f, 1.0f);
+    }
+    else {
+        float c = glm::dot(d1, r);
+        if (e <= EPS) {
+            s = std::clamp(-c / a, 0.0f, 1.0f);
+        }
+        else {
+            float b = glm::dot(d1, d2);
+            float denom = a * e - b * b;
+            s = denom != 0.0f ? std::clamp((b * f - c * e) / denom, 0.0f, 1.0f) : 0.0f;
+            t = (b * s + f) / e;
+            if (t < 0.0f) {
+                t = 0.0f;
+                s = std::clamp(-c / a, 0.0f, 1.0f);
+            }
+            else if (t > 1.0f) {
+                t = 1.0f;
+                s = std::clamp((b - c) / a, 0.0f, 1.0f);
+            }
+        }
+    }
+    c1 = p1 + d1 * s;
+    c2 = p2 + d2 * t;
+    return glm::dot(c1 - c2, c1 - c2);
+}
+
+bool insideTriangle(const glm::vec3& p, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, const glm::vec3& n) {
+    return glm::dot(glm::cross(v1 - v0, p - v0), n) >= 0.0f
+        && glm::dot(glm::cross(v2 - v1, p - v1), n) >= 0.0f
+        && glm::dot(glm::cross(v0 - v2, p - v2), n) >= 0.0f;
+}
+
+// Distance between segment ab and triangle v0 v1 v2 with normal n. point is
+// the closest point on the triangle and normal the direction from it to the
+// segment.
+float segmentTriangleDistance(const glm::vec3& a, const glm::vec3& b, const glm::vec3& v0, const glm::vec3& v1,
+    const glm::vec3& v2, const glm::vec3& n, glm::vec3& point, glm::vec3& normal) {
+    float da = glm::dot(a - v0, n), db = glm::dot(b - v0, n);
+    if ((da <= 0.0f) != (db <= 0.0f)) {
+        glm::vec3 crossing = a + (b - a) * (da / (da - db));
+        if (insideTriangle(crossing, v0, v1, v2, n)) {
+            point = crossing;
+            normal = n;
+            return 0.0f;
+        }
+    }
+
+    // Otherwise the closest pair is an endpoint and the face, or the segment
+    // and an edge
+    float best = std::numeric_limits<float>::max();
+    for (int i = 0; i < 2; ++i) {
+        const glm::vec3& end = i == 0 ? a : b;
+        float dist = i == 0 ? da : db;
+        glm::vec3 q = end - n * dist;
+        if (std::abs(dist) < best && insideTriangle(q, v0, v1, v2, n)) {
+            best = std::abs(dist);
+            point = q;
+            normal = dist >= 0.0f ? n : -n;
+        }
+    }
+    const glm::vec3* edges[3][2] = { { &v0, &v1 }, { &v1, &v2 }, { &v2, &v0 } };
+    for (const auto& edge : edges) {
+        glm::vec3 onSegment, onEdge;
+        float d2 = closestSegmentSegment(a, b, *edge[0], *edge[1], onSegment, onEdge);
+        if (d2 >= best * best)
+            continue;
+        best = std::sqrt(d2);
+        point = onEdge;
+        normal = best > 1e-6f ? (onSegment - onEdge) / best : n;
+    }
+    return best;
+}
+
+// Earliest time before tMax at which capsule segment ab with radius, moving
+// by d, touches triangle v0 v1 v2. The distance between two convex shapes is
+// convex in time as one translates, so each Newton step along it lands at or
+// before the contact (conservative advancement), and once the distance stops
+// shrinking it never will.
+bool sweepTriangle(const glm::vec3& a, const glm::vec3& b, float radius, const glm::vec3& d, float dLength,
+    const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float tMax, TerrainSweepHit& hit) {
+    glm::vec3 n = glm::normalize(glm::cross(v1 - v0, v2 - v0));
+    // Only faces the capsule moves into. A capsule coming down onto the
+    // terrain always meets one of those first; skipping the rest keeps it from
+    // catching on the edges of faces it's sliding along or leaving, like the
+    // diagonal between two coplanar triangles.
+    if (glm::dot(d, n) >= -SWEEP_MIN_APPROACH * dLength)
+        return false;
+    float t = 0.0f;
+    glm::vec3 point, normal;
+    for (int i = 0; i < SWEEP_ITERATIONS; ++i) {
+        float gap = segmentTriangleDistance(a + d * t, b + d * t, v0, v1, v2, n, point, normal) - radius;
+        float approach = -glm::dot(d, normal);
+        if (approach <= SWEEP_MIN_APPROACH * dLength)
+            return false;
+        if (gap <= SWEEP_TOLERANCE)
+            break;
+        t += gap / approach;
+        if (t >= tMax)
+            return false;
+    }
+    hit.time = t;
+    hit.point = point;
+    hit.normal = normal;
+    return true;
+}
+
+// Contacts gathered over the triangles near a capsule. Face contacts go
+// straight into the pair; the deepest edge or vertex contact only counts if
+// it beats every face contact, as it does at a convex edge. Elsewhere it is
+// an artifact of the triangulation (the shared edge of two coplanar faces).
+struct ContactGather {
+    TerrainContactPair pair;
+    float deepestFace = -std::numeric_limits<float>::max();
+    TerrainContact edge;
+    bool hasEdge = false;
+
+    void keep(const TerrainContact& contact, bool ground) {
+        TerrainContact& kept = ground ? pair.ground : pair.steep;
+        bool& has = ground ? pair.hasGround : pair.hasSteep;
+        if (!has || contact.depth > kept.depth) {
+            kept = contact;
+            has = true;
+        }
+    }
+};
+
+// Capsule segment a (bottom) to b (top) with radius against triangle v0 v1 v2,
+// wound counter-clockwise seen from above
+void collideTriangle(const glm::vec3& a, const glm::vec3& b, float radius,
+    const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float minGroundNormalY, ContactGather& gather) {
+    glm::vec3 n = glm::normalize(glm::cross(v1 - v0, v2 - v0));
+
+    // The segment is vertical and the normal points up, so the bottom end is
+    // its closest point to the plane; if that's clear, the whole capsule is
+    float dist = glm::dot(a - v0, n);
+    if (dist >= radius + CONTACT_SLOP)
+        return;
+
+    glm::vec3 q = a - n * dist;
+    if (insideTriangle(q, v0, v1, v2, n)) {
+        gather.keep({ q, n, radius - dist }, n.y >= minGroundNormalY);
+        gather.deepestFace = std::max(gather.deepestFace, radius - dist);
+        return;
+    }
+
+    // Otherwise the closest feature is an edge or a vertex
+    const glm::vec3* edges[3][2] = { { &v0, &v1 }, { &v1, &v2 }, { &v2, &v0 } };
+    for (const auto& edge : edges) {
+        glm::vec3 onSegment, onEdge;
+        float d2 = closestSegmentSegment(a, b, *edge[0], *edge[1], onSegment, onEdge);
+        if (d2 >= (radius + CONTACT_SLOP) * (radius + CONTACT_SLOP))
+            continue;
+        float d = std::sqrt(d2);
+        glm::vec3 normal = d > 1e-6f ? (onSegment - onEdge) / d : n;
+        // Below the surface; the neighbouring face reports that contact
+        if (glm::dot(normal, n) <= 0.0f)
+            continue;
+        if (!gather.hasEdge || radius - d > gather.edge.depth) {
+            gather.edge = { onEdge, normal, radius - d };
+            gather.hasEdge = true;
+        }
+    }
+}
+
+}
+
+TerrainCollider::TerrainCollider(const HeightGrid& grid, const HeightfieldMinMax& minMax)
+    : grid(grid), minMax(minMax) {
+}
+
+bool TerrainCollider::findContact(const glm::vec3& center, float halfHeight, float radius, TerrainContact& out) const {
+    TerrainContactPair contacts;
+    findContacts(center, halfHeight, radius, CapsuleMoveSettings(), contacts);
+    if (contacts.hasGround && (!contacts.hasSteep || contacts.ground.depth >= contacts.steep.depth))
+        out = contacts.ground;
+    else if (contacts.hasSteep)
+        out = contacts.steep;
+    return contacts.hasGround || contacts.hasSteep;
+}
+
+void TerrainCollider::findContacts(const glm::vec3& center, float halfHeight, float radius,
+    const CapsuleMoveSettings& settings, TerrainContactPair& out) const {
+    out = TerrainContactPair();
+    const float s = grid.spacing;
+    const float lowest = center.y - halfHeight;
+
+    // Cells under the capsule's footprint, then one pyramid lookup over them
+    int x0 = (int)std::floor((center.x - radius) / s), x1 = (int)std::floor((center.x + radius) / s) + 1;
+    int z0 = (int)std::floor((center.z - radius) / s), z1 = (int)std::floor((center.z + radius) / s) + 1;
+    x0 = std::max(x0, 0);
+    z0 = std::max(z0, 0);
+    x1 = std::min(x1, minMax.cellsW);
+    z1 = std::min(z1, minMax.cellsH);
+    float minH, maxH;
+    if (!minMax.rangeMinMax(x0, z0, x1, z1, minH, maxH) || lowest > maxH)
+        return;
+
+    float segmentHalf = std::max(halfHeight - radius, 0.0f);
+    glm::vec3 a(center.x, center.y - segmentHalf, center.z);
+    glm::vec3 b(center.x, center.y + segmentHalf, center.z);
+
+    ContactGather gather;
+    const MinMaxLevel& cells = minMax.levels[0];
+    for (int z = z0; z < z1; ++z) {
+        for (int x = x0; x < x1; ++x) {
+            if (lowest > cells.maxH[z * cells.w + x])
+                continue;
+            // Split along (x + 1, z) - (x, z + 1), as the meshes are
+            glm::vec3 p00(x * s, grid.at(x, z), z * s);
+            glm::vec3 p10((x + 1) * s, grid.at(x + 1, z), z * s);
+            glm::vec3 p01(x * s, grid.at(x, z + 1), (z + 1) * s);
+            glm::vec3 p11((x + 1) * s, grid.at(x + 1, z + 1), (z + 1) * s);
+            collideTriangle(a, b, radius, p00, p01, p10, settings.minGroundNormalY, gather);
+            collideTriangle(a, b, radius, p10, p01, p11, settings.minGroundNormalY, gather);
+        }
+    }
+
+    // An edge low enough on the capsule to step onto counts as ground,
+    // however steep the contact normal is; that's what climbs steps
+    if (gather.hasEdge && gather.edge.depth > gather.deepestFace) {
+        bool stepOnto = gather.edge.normal.y > 0.0f && gather.edge.point.y - lowest <= settings.stepHeight;
+        gather.keep(gather.edge, stepOnto || gather.edge.normal.y >= settings.minGroundNormalY);
+    }
+    out = gather.pair;
+}
+
+bool TerrainCollider::sweepCapsule(const glm::vec3& center, const glm::vec3& displacement, float halfHeight,
+    float radius, TerrainSweepHit& hit) const {
+    float length = glm::length(displacement);
+    if (length <= 0.0f)
+        return false;
+    const float s = grid.spacing;
+    float segmentHalf = std::max(halfHeight - radius, 0.0f);
+    glm::vec3 a(center.x, center.y - segmentHalf, center.z);
+    glm::vec3 b(center.x, center.y + segmentHalf, center.z);
+    const MinMaxLevel& cells = minMax.levels[0];
+
+    // Walk the cells the centre crosses (Amanatides & Woo), testing the
+    // capsule's footprint over each span of the path. A contact is in the
+    // footprint of the span it happens in, so once one is found before the
+    // current span ends, later spans can't beat it.
+    float fx = center.x / s, fz = center.z / s;
+    float dx = displacement.x / s, dz = displacement.z / s;
+    const float NEVER = std::numeric_limits<float>::max();
+    float stepX = dx != 0.0f ? 1.0f / std::abs(dx) : NEVER;
+    float stepZ = dz != 0.0f ? 1.0f / std::abs(dz) : NEVER;
+    float nextX = dx > 0.0f ? (std::floor(fx) + 1.0f - fx) * stepX : dx < 0.0f ? (fx - std::floor(fx)) * stepX : NEVER;
+    float nextZ = dz > 0.0f ? (std::floor(fz) + 1.0f - fz) * stepZ : dz < 0.0f ? (fz - std::floor(fz)) * stepZ : NEVER;
+
+    float best = 1.0f;
+    bool found = false;
+    for (float enter = 0.0f; enter < best;) {
+        float exit = std::min({ nextX, nextZ, 1.0f });
+        glm::vec3 p0 = center + displacement * enter, p1 = center + displacement * exit;
+        int x0 = std::max((int)std::floor((std::min(p0.x, p1.x) - radius) / s), 0);
+        int z0 = std::max((int)std::floor((std::min(p0.z, p1.z) - radius) / s), 0);
+        int x1 = std::min((int)std::floor((std::max(p0.x, p1.x) + radius) / s) + 1, minMax.cellsW);
+        int z1 = std::min((int)std::floor((std::max(p0.z, p1.z) + radius) / s) + 1, minMax.cellsH);
+        float lowest = std::min(p0.y, p1.y) - halfHeight;
+        float minH, maxH;
+        if (minMax.rangeMinMax(x0, z0, x1, z1, minH, maxH) && lowest <= maxH) {
+            for (int z = z0; z < z1; ++z) {
+                for (int x = x0; x < x1; ++x) {
+                    if (lowest > cells.maxH[z * cells.w + x])
+                        continue;
+                    glm::vec3 p00(x * s, grid.at(x, z), z * s);
+                    glm::vec3 p10((x + 1) * s, grid.at(x + 1, z), z * s);
+                    glm::vec3 p01(x * s, grid.at(x, z + 1), (z + 1) * s);
+                    glm::vec3 p11((x + 1) * s, grid.at(x + 1, z + 1), (z + 1) * s);
+                    if (sweepTriangle(a, b, radius, displacement, length, p00, p01, p10, best, hit)) {
+                        best = hit.time;
+                        found = true;
+                    }
+                    if (sweepTriangle(a, b, radius, displacement, length, p10, p01, p11, best, hit)) {
+                        best = hit.time;
+                        found = true;
+                    }
+                }
+            }
+        }
+        if (exit >= 1.0f)
+            break;
+        if (nextX < nextZ) {
+            enter = nextX;
+            nextX += stepX;
+        }
+        else {
+            enter = nextZ;
+            nextZ += stepZ;
+        }
+    }
+    if (found)
+        hit.time = best;
+    return found;
+}
+
+CapsuleMoveResult TerrainCollider::resolve(glm::vec3 position, float halfHeight, float radius,
+    const CapsuleMoveSettings& settings) const {
+    CapsuleMoveResult result;
+    for (int i = 0; i < settings.maxIterations; ++i) {
+        TerrainContactPair contacts;
+        findContacts(position, halfHeight, radius, settings, contacts);
+
+        bool pushed = false;
+        if (contacts.hasGround) {
+            // Straight up off walkable ground, as far as it takes to clear
+            // the contact along its normal
+            const TerrainContact& ground = contacts.ground;
+            result.onGround = true;
+            result.groundNormal = ground.normal;
+            result.groundPoint = ground.point;
+            if (ground.depth > CONTACT_SLOP) {
+                position.y += ground.depth / ground.normal.y;
+                result.stepped = result.stepped || ground.normal.y < settings.minGroundNormalY;
+                pushed = true;
+            }
+        }
+        if (contacts.hasSteep) {
+            // Steep slopes push sideways only, so they never hold the capsule
+            // up and it slides down them. A capsule still wedged on the last
+            // pass goes out along the normal instead, so it can't sink.
+            const TerrainContact& steep = contacts.steep;
+            result.hitSteep = true;
+            result.steepNormal = steep.normal;
+            result.steepPoint = steep.point;
+            if (steep.depth > CONTACT_SLOP) {
+                float sideways = std::sqrt(steep.normal.x * steep.normal.x + steep.normal.z * steep.normal.z);
+                if (i + 1 < settings.maxIterations && sideways > 1e-3f)
+                    position += glm::vec3(steep.normal.x, 0.0f, steep.normal.z) * (steep.depth / (sideways * sideways));
+                else
+                    position += steep.normal * steep.depth;
+                pushed = true;
+            }
+        }
+        if (!pushed)
+            break;
+    }
+    result.position = position;
+    return result;
+}
+
+// The move without stepping up or snapping down. Sweep it so it stops at the
+// first contact, then carry it a little past so resolve() responds as it
+// would to a short move. What's left slides along the contact the way
+// resolve() moves the capsule (along walkable ground, sideways along steep
+// slopes) and is swept again.
+CapsuleMoveResult TerrainCollider::slide(const glm::vec3& position, const glm::vec3& displacement, float halfHeight,
+    float radius, const CapsuleMoveSettings& settings) const {
+    // The map's edges are walls; past them there is nothing to stand on
+    glm::vec3 target = position + displacement;
+    target.x = std::clamp(target.x, 0.0f, grid.extentX());
+    target.z = std::clamp(target.z, 0.0f, grid.extentZ());
+
+    glm::vec3 current = position, remaining = target - position;
+    CapsuleMoveResult result;
+    bool hitSteep = false, stepped = false;
+    glm::vec3 steepNormal, steepPoint;
+    for (int sweep = 1;; ++sweep) {
+        float advance = 1.0f;
+        float remainingLength = glm::length(remaining);
+        TerrainSweepHit hit;
+        // No sweep needed for a move no longer than the overshoot: resolve()
+        // would see anything it could pass through
+        if (remainingLength > radius * SWEEP_OVERSHOOT && sweepCapsule(current, remaining, halfHeight, radius, hit))
+            advance = std::min(1.0f, hit.time + radius * SWEEP_OVERSHOOT / remainingLength);
+        result = resolve(current + remaining * advance, halfHeight, radius, settings);
+        if (result.hitSteep) {
+            hitSteep = true;
+            steepNormal = result.steepNormal;
+            steepPoint = result.steepPoint;
+        }
+        stepped = stepped || result.stepped;
+        current = result.position;
+        if (advance >= 1.0f || sweep >= settings.maxSweeps)
+            break;
+
+        remaining *= 1.0f - advance;
+        if (result.hitSteep) {
+            glm::vec3 side(result.steepNormal.x, 0.0f, result.steepNormal.z);
+            float into = glm::dot(remaining, side), sideLength2 = glm::dot(side, side);
+            if (into < 0.0f && sideLength2 > 1e-6f)
+                remaining -= side * (into / sideLength2);
+        }
+        if (result.onGround) {
+            const glm::vec3& ground = result.groundNormal;
+            if (ground.y >= settings.minGroundNormalY)
+                remaining.y = -(ground.x * remaining.x + ground.z * remaining.z) / ground.y;
+            else
+                remaining.y = std::max(remaining.y, 0.0f);     // stepped onto an edge
+        }
+    }
+
+    // The last steep contact of any pass, not just the final one
+    if (hitSteep && !result.hitSteep) {
+        result.hitSteep = true;
+        result.steepNormal = steepNormal;
+        result.steepPoint = steepPoint;
+    }
+    result.stepped = result.stepped || stepped;
+    return result;
+}
+
+CapsuleMoveResult TerrainCollider::moveCapsule(const glm::vec3& position, const glm::vec3& displacement, float halfHeight,
+    float radius, bool wasOnGround, const CapsuleMoveSettings& settings) const {
+    CapsuleMoveResult result = slide(position, displacement, halfHeight, radius, settings);
+
+    // Stopped by the riser of a step: resolve() pushes off its face before
+    // the edge at the top is ever the deepest contact, so climb it here. Lift
+    // the capsule by stepHeight, walk, then sweep it straight back down (not
+    // slide(), whose overshoot would carry it into the riser's face) and keep
+    // that if it's further along and stands on something no higher than a step.
+    // The lifted walk doesn't step onto edges itself, or it would climb two.
+    // A riser spanning a whole cell slopes, and a short walk comes back down
+    // onto its face rather than the edge, so the walk is doubled, up to the
+    // radius, until it clears it.
+    const float lowest = position.y - halfHeight;
+    glm::vec3 walk(displacement.x, 0.0f, displacement.z);
+    float walkLength = glm::length(walk);
+    if (wasOnGround && result.hitSteep && settings.stepHeight > 0.0f && walkLength > 0.0f
+        && result.steepPoint.y - lowest <= settings.stepHeight) {
+        CapsuleMoveSettings lifted = settings;
+        lifted.stepHeight = 0.0f;
+        glm::vec3 lift(0.0f, settings.stepHeight, 0.0f);
+        for (float length = walkLength;; length = std::min(length * 2.0f, radius)) {
+            CapsuleMoveResult raised = slide(position + lift, walk * (length / walkLength), halfHeight, radius, lifted);
+            TerrainSweepHit hit;
+            if (sweepCapsule(raised.position, -lift, halfHeight, radius, hit)) {
+                float down = std::min(1.0f, hit.time + 2.0f * CONTACT_SLOP / settings.stepHeight);
+                CapsuleMoveResult landed = resolve(raised.position - lift * down, halfHeight, radius, settings);
+                float gained = glm::dot(landed.position - result.position, walk) / walkLength;
+                if (landed.onGround && landed.groundPoint.y - lowest <= settings.stepHeight + CONTACT_SLOP
+                    && gained > CONTACT_SLOP) {
+                    landed.hitSteep = landed.hitSteep || raised.hitSteep;
+                    landed.stepped = true;
+                    result = landed;
+                    break;
+                }
+            }
+            if (length >= radius)
+                break;
+        }
+    }
+
+    // Walking down a slope: stay on it rather than leave the ground for a tick
+    if (wasOnGround && !result.onGround && displacement.y <= 0.0f && settings.stepHeight > 0.0f) {
+        CapsuleMoveResult snapped = resolve(result.position - glm::vec3(0.0f, settings.stepHeight, 0.0f), halfHeight,
+            radius, settings);
+        if (snapped.onGround && !snapped.hitSteep) {
+            snapped.hitSteep = result.hitSteep;
+            snapped.stepped = result.stepped;
+            result = snapped;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "HeightGrid.h"
+#include "HeightfieldMinMax.h"
+#include <glm.hpp>
+
+// Capsules here are upright: a vertical segment halfHeight - radius either
+// side of the centre, swept by radius, so the lowest point sits halfHeight
+// below the centre (as with CapsuleCollider's height / 2).
+struct TerrainContact {
+    glm::vec3 point{ 0.0f };                // on the terrain
+    glm::vec3 normal{ 0.0f, 1.0f, 0.0f };   // out of the terrain, towards the capsule
+    float depth = 0.0f;     // penetration along normal
+};
+
+// Deepest contact with walkable ground and with slopes steeper than that
+struct TerrainContactPair {
+    TerrainContact ground, steep;
+    bool hasGround = false, hasSteep = false;
+};
+
+struct CapsuleMoveSettings {
+    float minGroundNormalY = 0.64f;     // cos of the steepest walkable slope (50 degrees)
+    float stepHeight = 0.5f;            // rises up to this much are stepped onto, not slid against
+    int maxIterations = 4;              // contact resolution passes per move
+    int maxSweeps = 4;                  // swept steps per move; each stops just past a contact
+};
+
+// First contact along a capsule's motion
+struct TerrainSweepHit {
+    float time = 1.0f;                      // fraction of the displacement travelled
+    glm::vec3 point{ 0.0f };                // on the terrain
+    glm::vec3 normal{ 0.0f, 1.0f, 0.0f };   // out of the terrain, towards the capsule
+};
+
+struct CapsuleMoveResult {
+    glm::vec3 position;
+    bool onGround = false;              // resting on a walkable slope
+    glm::vec3 groundNormal{ 0.0f, 1.0f, 0.0f };
+    glm::vec3 groundPoint{ 0.0f };
+    bool hitSteep = false;              // pushed back by a slope too steep to stand on
+    glm::vec3 steepNormal{ 0.0f, 1.0f, 0.0f };
+    glm::vec3 steepPoint{ 0.0f };
+    bool stepped = false;               // climbed an edge too steep to walk, within stepHeight
+};
+
+// Capsule against the heightfield's triangles, split along the same diagonal
+// as the rendered meshes. Contacts are found exactly, triangle by triangle,
+// but only in cells the min/max pyramid says the capsule can reach, so a
+// capsule in the air costs one pyramid lookup.
+class TerrainCollider {
+public:
+    TerrainCollider(const HeightGrid& grid, const HeightfieldMinMax& minMax);
+
+    // Deepest contact between the capsule and the terrain, if any
+    bool findContact(const glm::vec3& center, float halfHeight, float radius, TerrainContact& out) const;
+
+    // Deepest contacts split into ground and steep by settings.minGroundNormalY.
+    // An edge within settings.stepHeight of the capsule's lowest point counts
+    // as ground whatever its slope, so it is stepped onto rather than slid off.
+    void findContacts(const glm::vec3& center, float halfHeight, float radius, const CapsuleMoveSettings& settings,
+        TerrainContactPair& out) const;
+
+    // First contact as the capsule moves by displacement, walking the cells
+    // under its path in order. Contacts the capsule is sliding along or
+    // moving away from don't count, so a capsule resting on the ground only
+    // hits it when it moves into it.
+    bool sweepCapsule(const glm::vec3& center, const glm::vec3& displacement, float halfHeight, float radius,
+        TerrainSweepHit& hit) const;
+
+    // Character-style move by displacement. Penetration into ground is
+    // resolved straight up, so standing capsules don't creep downhill and
+    // walking into a low edge lifts the capsule onto it; steeper contacts push
+    // out sideways, so the capsule slides down them. Grounded capsules moving
+    // down a slope are snapped to it within stepHeight instead of stepping off
+    // into the air. A grounded capsule stopped by a steep contact no higher
+    // than stepHeight above its lowest point tries the move again lifted by
+    // stepHeight and set back down, and keeps that if it lands on ground no
+    // higher than that. The capsule is kept within the grid's extent. The
+    // move is swept, so a long one (a fast capsule or a low tick rate) stops
+    // at a ridge rather than passing through it.
+    CapsuleMoveResult moveCapsule(const glm::vec3& position, const glm::vec3& displacement, float halfHeight,
+        float radius, bool wasOnGround, const CapsuleMoveSettings& settings) const;
+
+private:
+    const HeightGrid& grid;
+    const HeightfieldMinMax& minMax;
+
+    CapsuleMoveResult resolve(glm::vec3 position, float halfHeight, float radius, const CapsuleMoveSettings& settings) const;
+    CapsuleMoveResult slide(const glm::vec3& position, const glm::vec3& displacement, float halfHeight, float radius,
+        const CapsuleMoveSettings& settings) const;
+};
@@ -0,0 +1,145 @@
+#include "TerrainRaycaster.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const float NEVER = std::numeric_limits<float>::max();
+
+// Narrows [tMin, tMax] to where o + d * t lies in [lo, hi]
+bool clipSlab(float o, float d, float lo, float hi, float& tMin, float& tMax) {
+    if (d == 0.0f)
+        return o >= lo && o <= hi;
+    float t0 = (lo - o) / d, t1 = (hi - o) / d;
+    if (t0 > t1)
+        std::swap(t0, t1);
+    tMin = std::max(tMin, t0);
+    tMax = std::min(tMax, t1);
+    return tMin <= tMax;
+}
+
+// Index of the size-wide texel holding coordinate p. On a boundary, the one
+// a ray moving by d is entering.
+int texelIndex(float p, float d, int size) {
+    float f = p / size;
+    return d < 0.0f ? (int)std::ceil(f) - 1 : (int)std::floor(f);
+}
+
+// Two-sided Moller-Trumbore
+bool intersectTriangle(const glm::vec3& o, const glm::vec3& d, const glm::vec3& v0, const glm::vec3& v1,
+    const glm::vec3& v2, float& t) {
+    glm::vec3 e1 = v1 - v0, e2 = v2 - v0;
+    glm::vec3 p = glm::cross(d, e2);
+    float det = glm::dot(e1, p);
+    if (std::abs(det) < 1e-12f)
+        return false;
+    float inv = 1.0f / det;
+    glm::vec3 s = o - v0;
+    float u = glm::dot(s, p) * inv;
+    if (u < 0.0f || u > 1.0f)
+        return false;
+    glm::vec3 q = glm::cross(s, e1);
+    float v = glm::dot(d, q) * inv;
+    if (v < 0.0f || u + v > 1.0f)
+        return false;
+    t = glm::dot(e2, q) * inv;
+    return true;
+}
+
+}
+
+TerrainRaycaster::TerrainRaycaster(const HeightGrid& grid, const HeightfieldMinMax& minMax)
+    : grid(grid), minMax(minMax) {
+}
+
+bool TerrainRaycaster::intersectCell(int x, int z, const glm::vec3& origin, const glm::vec3& dir, float tMin,
+    float tMax, TerrainRayHit& hit) const {
+    const float s = grid.spacing;
+    // Split along (x + 1, z) - (x, z + 1), as the meshes are
+    glm::vec3 p00(x * s, grid.at(x, z), z * s);
+    glm::vec3 p10((x + 1) * s, grid.at(x + 1, z), z * s);
+    glm::vec3 p01(x * s, grid.at(x, z + 1), (z + 1) * s);
+    glm::vec3 p11((x + 1) * s, grid.at(x + 1, z + 1), (z + 1) * s);
+    const glm::vec3* triangles[2][3] = { { &p00, &p01, &p10 }, { &p10, &p01, &p11 } };
+
+    bool found = false;
+    for (const auto& tri : triangles) {
+        float t;
+        if (!intersectTriangle(origin, dir, *tri[0], *tri[1], *tri[2], t) || t < tMin || t > tMax)
+            continue;
+        tMax = t;
+        hit.hit = true;
+        hit.distance = t;
+        hit.normal = glm::normalize(glm::cross(*tri[1] - *tri[0], *tri[2] - *tri[0]));
+        found = true;
+    }
+    if (found)
+        hit.point = origin + dir * hit.distance;
+    return found;
+}
+
+bool TerrainRaycaster::raycast(const TerrainRay& ray, TerrainRayHit& hit) const {
+    hit = TerrainRayHit();
+    float length = glm::length(ray.direction);
+    if (minMax.levels.empty() || !(length > 0.0f))
+        return false;
+    const glm::vec3 dir = ray.direction / length;
+    const float s = grid.spacing;
+
+    // Cell units across, world units up; t is world distance along the ray
+    const float ox = ray.origin.x / s, oz = ray.origin.z / s;
+    const float dx = dir.x / s, dz = dir.z / s;
+
+    // Clip to the heightfield's bounds; the top level's one texel holds the
+    // lowest and highest points
+    const MinMaxLevel& top = minMax.levels.back();
+    float tMin = 0.0f, tMax = ray.maxDistance;
+    if (!clipSlab(ox, dx, 0.0f, (float)minMax.cellsW, tMin, tMax)
+        || !clipSlab(oz, dz, 0.0f, (float)minMax.cellsH, tMin, tMax)
+        || !clipSlab(ray.origin.y, dir.y, top.minH[0], top.maxH[0], tMin, tMax))
+        return false;
+
+    const int topLevel = (int)minMax.levels.size() - 1;
+    int level = topLevel;
+    float t = tMin;
+    for (;;) {
+        const MinMaxLevel& l = minMax.levels[level];
+        const int size = 1 << level;
+        int ix = std::clamp(texelIndex(ox + dx * t, dx, size), 0, l.w - 1);
+        int iz = std::clamp(texelIndex(oz + dz * t, dz, size), 0, l.h - 1);
+
+        // Where the ray leaves this texel
+        float exitX = dx > 0.0f ? ((ix + 1) * size - ox) / dx : dx < 0.0f ? (ix * size - ox) / dx : NEVER;
+        float exitZ = dz > 0.0f ? ((iz + 1) * size - oz) / dz : dz < 0.0f ? (iz * size - oz) / dz : NEVER;
+        float tExit = std::min({ exitX, exitZ, tMax });
+        if (!(tExit > t))
+            tExit = std::min(std::nextafter(t, NEVER), tMax);
+
+        // The ray's height is linear in t, so its range over the span is the
+        // heights at either end
+        float y0 = ray.origin.y + dir.y * t, y1 = ray.origin.y + dir.y * tExit;
+        int texel = iz * l.w + ix;
+        bool skip = std::min(y0, y1) > l.maxH[texel] || std::max(y0, y1) < l.minH[texel];
+        if (!skip && level > 0) {
+            --level;
+            continue;
+        }
+        // A cell's triangles lie within it, so the first cell with a hit holds
+        // the nearest one
+        if (!skip && intersectCell(ix, iz, ray.origin, dir, tMin, ray.maxDistance, hit))
+            return true;
+        if (tExit >= tMax)
+            return false;
+        t = tExit;
+        level = std::min(level + 1, topLevel);
+    }
+}
+
+void TerrainRaycaster::raycast(const TerrainRay* rays, TerrainRayHit* hits, size_t count) const {
+    JobSystem::instance().parallelFor(0, count, BATCH_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            raycast(rays[i], hits[i]);
+    });
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "HeightGrid.h"
+#include "HeightfieldMinMax.h"
+#include <glm.hpp>
+#include <cstddef>
+
+struct TerrainRay {
+    glm::vec3 origin{ 0.0f };
+    glm::vec3 direction{ 0.0f, -1.0f, 0.0f };   // needn't be normalized
+    float maxDistance = 1e30f;                  // along the direction, in world units
+};
+
+struct TerrainRayHit {
+    bool hit = false;
+    float distance = 0.0f;                  // from the ray's origin
+    glm::vec3 point{ 0.0f };
+    glm::vec3 normal{ 0.0f, 1.0f, 0.0f };   // of the triangle hit, pointing up
+};
+
+// Rays against the heightfield's triangles, split along the same diagonal as
+// the rendered meshes, for picking, line of sight and camera collision.
+//
+// The ray walks the min/max pyramid from the top. A texel the ray passes
+// wholly above (or below) over its span is skipped in one step and the walk
+// climbs back a level; otherwise it descends. Only the cells at the bottom
+// that the ray dips into are intersected exactly, so a long ray over low
+// ground costs a handful of steps rather than one per cell.
+class TerrainRaycaster {
+public:
+    TerrainRaycaster(const HeightGrid& grid, const HeightfieldMinMax& minMax);
+
+    // Nearest hit within ray.maxDistance, from either side of the surface
+    bool raycast(const TerrainRay& ray, TerrainRayHit& hit) const;
+
+    // hits[i] for rays[i], split into batches across the job system
+    void raycast(const TerrainRay* rays, TerrainRayHit* hits, size_t count) const;
+
+    // Rays per job in the batched raycast
+    static const size_t BATCH_GRAIN = 1024;
+
+private:
+    const HeightGrid& grid;
+    const HeightfieldMinMax& minMax;
+
+    bool intersectCell(int x, int z, const glm::vec3& origin, const glm::vec3& dir, float tMin, float tMax,
+        TerrainRayHit& hit) const;
+};
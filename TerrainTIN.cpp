@@ -0,0 +1,495 @@
+// The triangulation (the triangle and edge bookkeeping, the candidate heap,
+// legalize and the collinear split) is ported from Delatin,
+// https://github.com/mapbox/delatin, under the ISC licence:
+//
+// ISC License
+//
+// Copyright (c) 2020, Mapbox
+//
+// Permission to use, copy, modify, and/or distribute this software for any purpose
+// with or without fee is hereby granted, provided that the above copyright notice
+// and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+#include "TerrainTIN.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+static int64_t orient(int ax, int ay, int bx, int by, int cx, int cy) {
+    return int64_t(bx - cx) * (ay - cy) - int64_t(by - cy) * (ax - cx);
+}
+
+static bool inCircle(int ax, int ay, int bx, int by, int cx, int cy, int px, int py) {
+    double dx = ax - px, dy = ay - py;
+    double ex = bx - px, ey = by - py;
+    double fx = cx - px, fy = cy - py;
+    double ap = dx * dx + dy * dy;
+    double bp = ex * ex + ey * ey;
+    double cp = fx * fx + fy * fy;
+    return dx * (ey * cp - bp * fy) - dy * (ex * cp - bp * fx) + ap * (ex * fy - ey * fx) < 0.0;
+}
+
+TinTriangulator::TinTriangulator(const float* data, int w, int h, int stride, bool lockBorder)
+    : data(data), w(w), h(h), stride(stride), lockBorder(lockBorder) {
+    int p0 = addPoint(0, 0);
+    int p1 = addPoint(w - 1, 0);
+    int p2 = addPoint(0, h - 1);
+    int p3 = addPoint(w - 1, h - 1);
+    int t0 = addTriangle(p3, p0, p2, -1, -1, -1);
+    addTriangle(p0, p3, p1, t0, -1, -1);
+}
+
+int TinTriangulator::addPoint(int x, int y) {
+    int i = (int)coords.size() / 2;
+    coords.push_back(x);
+    coords.push_back(y);
+    return i;
+}
+
+int TinTriangulator::addTriangle(int a, int b, int c, int ab, int bc, int ca, int e) {
+    if (e < 0) {
+        e = (int)triangles.size();
+        triangles.resize(e + 3);
+        halfedges.resize(e + 3);
+        candidates.resize((e / 3 + 1) * 2);
+        queueIndices.resize(e / 3 + 1);
+    }
+    int t = e / 3;
+    triangles[e + 0] = a;
+    triangles[e + 1] = b;
+    triangles[e + 2] = c;
+    halfedges[e + 0] = ab;
+    halfedges[e + 1] = bc;
+    halfedges[e + 2] = ca;
+    if (ab >= 0) halfedges[ab] = e + 0;
+    if (bc >= 0) halfedges[bc] = e + 1;
+    if (ca >= 0) halfedges[ca] = e + 2;
+
+    candidates[2 * t + 0] = 0;
+    candidates[2 * t + 1] = 0;
+    queueIndices[t] = -1;
+    pending.push_back(t);
+    return e;
+}
+
+void TinTriangulator::flush() {
+    for (int t : pending)
+        findCandidate(t);
+    pending.clear();
+}
+
+// Rasterizes the triangle over the sample grid with edge functions and
+// records the sample with the largest vertical error as its candidate.
+void TinTriangulator::findCandidate(int t) {
+    const int a = triangles[t * 3 + 0], b = triangles[t * 3 + 1], c = triangles[t * 3 + 2];
+    const int p0x = coords[2 * a], p0y = coords[2 * a + 1];
+    const int p1x = coords[2 * b], p1y = coords[2 * b + 1];
+    const int p2x = coords[2 * c], p2y = coords[2 * c + 1];
+
+    const int minX = std::min({ p0x, p1x, p2x }), minY = std::min({ p0y, p1y, p2y });
+    const int maxX = std::max({ p0x, p1x, p2x }), maxY = std::max({ p0y, p1y, p2y });
+
+    int64_t w00 = orient(p1x, p1y, p2x, p2y, minX, minY);
+    int64_t w01 = orient(p2x, p2y, p0x, p0y, minX, minY);
+    int64_t w02 = orient(p0x, p0y, p1x, p1y, minX, minY);
+    const int64_t a01 = p1y - p0y, b01 = p0x - p1x;
+    const int64_t a12 = p2y - p1y, b12 = p1x - p2x;
+    const int64_t a20 = p0y - p2y, b20 = p2x - p0x;
+
+    const double area = (double)orient(p0x, p0y, p1x, p1y, p2x, p2y);
+    const double z0 = heightAt(p0x, p0y) / area;
+    const double z1 = heightAt(p1x, p1y) / area;
+    const double z2 = heightAt(p2x, p2y) / area;
+
+    float maxErr = 0.0f;
+    int mx = p0x, my = p0y;
+    for (int y = minY; y <= maxY; ++y) {
+        // Skip straight to the first column inside the triangle
+        int64_t dx = 0;
+        if (w00 < 0 && a12 != 0) dx = std::max<int64_t>(dx, -w00 / a12);
+        if (w01 < 0 && a20 != 0) dx = std::max<int64_t>(dx, -w01 / a20);
+        if (w02 < 0 && a01 != 0) dx = std::max<int64_t>(dx, -w02 / a01);
+
+        int64_t w0 = w00 + a12 * dx;
+        int64_t w1 = w01 + a20 * dx;
+        int64_t w2 = w02 + a01 * dx;
+        bool wasInside = false;
+        for (int x = minX + (int)dx; x <= maxX; ++x) {
+            if (w0 >= 0 && w1 >= 0 && w2 >= 0) {
+                wasInside = true;
+                bool border = lockBorder && (x == 0 || y == 0 || x == w - 1 || y == h - 1);
+                if (!border) {
+                    float z = float(z0 * w0 + z1 * w1 + z2 * w2);
+                    float dz = std::abs(z - heightAt(x, y));
+                    if (dz > maxErr) {
+                        maxErr = dz;
+                        mx = x;
+                        my = y;
+                    }
+                }
+            }
+            else if (wasInside) {
+                break;
+            }
+            w0 += a12;
+            w1 += a20;
+            w2 += a01;
+        }
+        w00 += b12;
+        w01 += b20;
+        w02 += b01;
+    }
+
+    if ((mx == p0x && my == p0y) || (mx == p1x && my == p1y) || (mx == p2x && my == p2y))
+        maxErr = 0.0f;
+
+    candidates[2 * t + 0] = mx;
+    candidates[2 * t + 1] = my;
+    queuePush(t, maxErr);
+}
+
+void TinTriangulator::split(int t, int px, int py) {
+    const int e0 = t * 3 + 0, e1 = t * 3 + 1, e2 = t * 3 + 2;
+    const int p0 = triangles[e0], p1 = triangles[e1], p2 = triangles[e2];
+    const int ax = coords[2 * p0], ay = coords[2 * p0 + 1];
+    const int bx = coords[2 * p1], by = coords[2 * p1 + 1];
+    const int cx = coords[2 * p2], cy = coords[2 * p2 + 1];
+    const int pn = addPoint(px, py);
+
+    if (orient(ax, ay, bx, by, px, py) == 0) {
+        handleCollinear(pn, e0);
+    }
+    else if (orient(bx, by, cx, cy, px, py) == 0) {
+        handleCollinear(pn, e1);
+    }
+    else if (orient(cx, cy, ax, ay, px, py) == 0) {
+        handleCollinear(pn, e2);
+    }
+    else {
+        const int h0 = halfedges[e0], h1 = halfedges[e1], h2 = halfedges[e2];
+        const int t0 = addTriangle(p0, p1, pn, h0, -1, -1, e0);
+        const int t1 = addTriangle(p1, p2, pn, h1, -1, t0 + 1);
+        const int t2 = addTriangle(p2, p0, pn, h2, t0 + 2, t1 + 1);
+        legalize(t0);
+        legalize(t1);
+        legalize(t2);
+    }
+}
+
+// Restores the Delaunay condition across halfedge a, flipping recursively.
+void TinTriangulator::legalize(int a) {
+    const int b = halfedges[a];
+    if (b < 0)
+        return;
+
+    const int a0 = a - a % 3, b0 = b - b % 3;
+    const int al = a0 + (a + 1) % 3, ar = a0 + (a + 2) % 3;
+    const int bl = b0 + (b + 2) % 3, br = b0 + (b + 1) % 3;
+    const int p0 = triangles[ar], pr = triangles[a], pl = triangles[al], p1 = triangles[bl];
+
+    if (!inCircle(coords[2 * p0], coords[2 * p0 + 1], coords[2 * pr], coords[2 * pr + 1],
+        coords[2 * pl], coords[2 * pl + 1], coords[2 * p1], coords[2 * p1 + 1]))
+        return;
+
+    const int hal = halfedges[al], har = halfedges[ar];
+    const int hbl = halfedges[bl], hbr = halfedges[br];
+    queueRemove(a0 / 3);
+    queueRemove(b0 / 3);
+    const int t0 = addTriangle(p0, p1, pl, -1, hbl, hal, a0);
+    const int t1 = addTriangle(p1, p0, pr, t0, har, hbr, b0);
+    legalize(t0 + 1);
+    legalize(t1 + 2);
+}
+
+// The new point lies on halfedge a: split it and the triangle across it.
+void TinTriangulator::handleCollinear(int pn, int a) {
+    const int a0 = a - a % 3;
+    const int al = a0 + (a + 1) % 3, ar = a0 + (a + 2) % 3;
+    const int p0 = triangles[ar], pr = triangles[a], pl = triangles[al];
+    const int hal = halfedges[al], har = halfedges[ar];
+    const int b = halfedges[a];
+
+    if (b < 0) {
+        const int t0 = addTriangle(pn, p0, pr, -1, har, -1, a0);
+        const int t1 = addTriangle(p0, pn, pl, t0, -1, hal);
+        legalize(t0 + 1);
+        legalize(t1 + 2);
+        return;
+    }
+
+    const int b0 = b - b % 3;
+    const int bl = b0 + (b + 2) % 3, br = b0 + (b + 1) % 3;
+    const int p1 = triangles[bl];
+    const int hbl = halfedges[bl], hbr = halfedges[br];
+    queueRemove(b0 / 3);
+    const int t0 = addTriangle(p0, pr, pn, har, -1, -1, a0);
+    const int t1 = addTriangle(pr, p1, pn, hbr, -1, t0 + 1, b0);
+    const int t2 = addTriangle(p1, pl, pn, hbl, -1, t1 + 1);
+    const int t3 = addTriangle(pl, p0, pn, hal, t0 + 2, t2 + 1);
+    legalize(t0);
+    legalize(t1);
+    legalize(t2);
+    legalize(t3);
+}
+
+void TinTriangulator::insertBorderPoint(int x, int y) {
+    // Find the hull edge the point lies on
+    for (int e = 0; e < (int)triangles.size(); ++e) {
+        if (halfedges[e] >= 0)
+            continue;
+        const int a = triangles[e], b = triangles[e - e % 3 + (e + 1) % 3];
+        const int ax = coords[2 * a], ay = coords[2 * a + 1];
+        const int bx = coords[2 * b], by = coords[2 * b + 1];
+        if (orient(ax, ay, bx, by, x, y) != 0)
+            continue;
+        if (x < std::min(ax, bx) || x > std::max(ax, bx) || y < std::min(ay, by) || y > std::max(ay, by))
+            continue;
+        if ((x == ax && y == ay) || (x == bx && y == by))
+            return; // already a vertex
+
+        queueRemove(e / 3);
+        handleCollinear(addPoint(x, y), e);
+        return;
+    }
+}
+
+void TinTriangulator::run(float maxErr) {
+    flush();
+    while (!queue.empty() && errors[0] > maxErr) {
+        const int t = queuePop();
+        split(t, candidates[2 * t], candidates[2 * t + 1]);
+        flush();
+    }
+}
+
+float TinTriangulator::maxError() {
+    flush();
+    return queue.empty() ? 0.0f : errors[0];
+}
+
+void TinTriangulator::queuePush(int t, float error) {
+    const int i = (int)queue.size();
+    queueIndices[t] = i;
+    queue.push_back(t);
+    errors.push_back(error);
+    queueUp(i);
+}
+
+int TinTriangulator::queuePop() {
+    const int n = (int)queue.size() - 1;
+    queueSwap(0, n);
+    queueDown(0, n);
+    return queuePopBack();
+}
+
+int TinTriangulator::queuePopBack() {
+    const int t = queue.back();
+    queue.pop_back();
+    errors.pop_back();
+    queueIndices[t] = -1;
+    return t;
+}
+
+void TinTriangulator::queueRemove(int t) {
+    const int i = queueIndices[t];
+    if (i < 0) {
+        // Not rasterized yet
+        auto it = std::find(pending.begin(), pending.end(), t);
+        if (it != pending.end()) {
+            *it = pending.back();
+            pending.pop_back();
+        }
+        return;
+    }
+    const int n = (int)queue.size() - 1;
+    if (n != i) {
+        queueSwap(i, n);
+        if (!queueDown(i, n))
+            queueUp(i);
+    }
+    queuePopBack();
+}
+
+void TinTriangulator::queueSwap(int i, int j) {
+    const int pi = queue[i], pj = queue[j];
+    queue[i] = pj;
+    queue[j] = pi;
+    queueIndices[pi] = j;
+    queueIndices[pj] = i;
+    std::swap(errors[i], errors[j]);
+}
+
+void TinTriangulator::queueUp(int j) {
+    while (j > 0) {
+        const int i = (j - 1) / 2;
+        if (!queueLess(j, i))
+            break;
+        queueSwap(i, j);
+        j = i;
+    }
+}
+
+bool TinTriangulator::queueDown(int i0, int n) {
+    int i = i0;
+    while (true) {
+        const int j1 = 2 * i + 1;
+        if (j1 >= n)
+            break;
+        const int j2 = j1 + 1;
+        int j = j1;
+        if (j2 < n && queueLess(j2, j1))
+            j = j2;
+        if (!queueLess(j, i))
+            break;
+        queueSwap(i, j);
+        i = j;
+    }
+    return i > i0;
+}
+
+static std::vector<float> flatten(const std::vector<std::vector<float>>& heightMap) {
+    std::vector<float> flat;
+    for (const auto& row : heightMap)
+        flat.insert(flat.end(), row.begin(), row.end());
+    return flat;
+}
+
+static size_t gridTriangleCount(int w, int h) {
+    return size_t(w - 1) * size_t(h - 1) * 2;
+}
+
+TinMesh buildTIN(const std::vector<std::vector<float>>& heightMap, float maxError, TinReport* report) {
+    auto start = std::chrono::steady_clock::now();
+    const int h = (int)heightMap.size();
+    const int w = (int)heightMap[0].size();
+    std::vector<float> flat = flatten(heightMap);
+
+    TinTriangulator tin(flat.data(), w, h, w);
+    tin.run(maxError);
+
+    TinMesh mesh{ std::move(tin.coords), std::move(tin.triangles) };
+    if (report) {
+        report->gridTriangles = gridTriangleCount(w, h);
+        report->tinTriangles = mesh.triangles.size() / 3;
+        report->vertices = mesh.coords.size() / 2;
+        report->tiles = 1;
+        report->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return mesh;
+}
+
+// 1D greedy insertion along a tile edge from (x0, z0) to (x1, z1). Always
+// walked in increasing coordinate order so both tiles sharing the edge get
+// identical vertices.
+static void simplifyEdge(const std::vector<float>& flat, int stride, int x0, int z0, int x1, int z1,
+    float maxError, std::vector<int>& out) {
+    const int dx = x1 > x0 ? 1 : 0, dz = z1 > z0 ? 1 : 0;
+    const int n = std::max(x1 - x0, z1 - z0);
+    auto heightAt = [&](int i) { return flat[(z0 + i * dz) * stride + x0 + i * dx]; };
+
+    std::vector<std::pair<int, int>> stack{ { 0, n } };
+    while (!stack.empty()) {
+        auto [a, b] = stack.back();
+        stack.pop_back();
+        float worst = 0.0f;
+        int worstI = -1;
+        for (int i = a + 1; i < b; ++i) {
+            float t = float(i - a) / float(b - a);
+            float err = std::abs(heightAt(i) - (heightAt(a) + (heightAt(b) - heightAt(a)) * t));
+            if (err > worst) {
+                worst = err;
+                worstI = i;
+            }
+        }
+        if (worst > maxError) {
+            out.push_back(worstI);
+            stack.push_back({ a, worstI });
+            stack.push_back({ worstI, b });
+        }
+    }
+}
+
+TinMesh buildTINTiled(const std::vector<std::vector<float>>& heightMap, float maxError, int tileCells,
+    TinReport* report) {
+    auto start = std::chrono::steady_clock::now();
+    const int h = (int)heightMap.size();
+    const int w = (int)heightMap[0].size();
+    std::vector<float> flat = flatten(heightMap);
+
+    const int tilesX = (w - 1 + tileCells - 1) / tileCells;
+    const int tilesZ = (h - 1 + tileCells - 1) / tileCells;
+    const int tileCount = tilesX * tilesZ;
+    std::vector<TinMesh> tileMeshes(tileCount);
+
+    auto buildTile = [&](int tile) {
+        const int x0 = (tile % tilesX) * tileCells;
+        const int z0 = (tile / tilesX) * tileCells;
+        const int x1 = std::min(x0 + tileCells, w - 1);
+        const int z1 = std::min(z0 + tileCells, h - 1);
+        const int tw = x1 - x0 + 1, th = z1 - z0 + 1;
+
+        TinTriangulator tin(flat.data() + z0 * w + x0, tw, th, w, true);
+        std::vector<int> edge;
+        simplifyEdge(flat, w, x0, z0, x1, z0, maxError, edge);
+        for (int i : edge) tin.insertBorderPoint(i, 0);
+        edge.clear();
+        simplifyEdge(flat, w, x0, z1, x1, z1, maxError, edge);
+        for (int i : edge) tin.insertBorderPoint(i, th - 1);
+        edge.clear();
+        simplifyEdge(flat, w, x0, z0, x0, z1, maxError, edge);
+        for (int i : edge) tin.insertBorderPoint(0, i);
+        edge.clear();
+        simplifyEdge(flat, w, x1, z0, x1, z1, maxError, edge);
+        for (int i : edge) tin.insertBorderPoint(tw - 1, i);
+
+        tin.run(maxError);
+        for (size_t i = 0; i < tin.coords.size(); i += 2) {
+            tin.coords[i] += x0;
+            tin.coords[i + 1] += z0;
+        }
+        tileMeshes[tile] = { std::move(tin.coords), std::move(tin.triangles) };
+    };
+
+    JobSystem::instance().parallelFor(0, tileCount, 1, [&](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; ++tile)
+            buildTile((int)tile);
+    });
+
+    // Merge, welding the shared border vertices
+    TinMesh mesh;
+    std::unordered_map<int64_t, unsigned int> welded;
+    for (const TinMesh& tm : tileMeshes) {
+        std::vector<unsigned int> remap(tm.coords.size() / 2);
+        for (size_t v = 0; v < remap.size(); ++v) {
+            const int x = tm.coords[2 * v], z = tm.coords[2 * v + 1];
+            auto [it, inserted] = welded.try_emplace(int64_t(z) * w + x, (unsigned int)(mesh.coords.size() / 2));
+            if (inserted) {
+                mesh.coords.push_back(x);
+                mesh.coords.push_back(z);
+            }
+            remap[v] = it->second;
+        }
+        for (unsigned int i : tm.triangles)
+            mesh.triangles.push_back(remap[i]);
+    }
+
+    if (report) {
+        report->gridTriangles = gridTriangleCount(w, h);
+        report->tinTriangles = mesh.triangles.size() / 3;
+        report->vertices = mesh.coords.size() / 2;
+        report->tiles = tileCount;
+        report->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return mesh;
+}
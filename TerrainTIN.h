@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+// Irregular triangulation of a heightfield: sample-space vertex coordinates
+// (x, z pairs) and triangle indices into them.
+struct TinMesh {
+    std::vector<int> coords;
+    std::vector<unsigned int> triangles;
+};
+
+struct TinReport {
+    size_t gridTriangles = 0;   // what generateIndices' uniform grid would draw
+    size_t tinTriangles = 0;
+    size_t vertices = 0;
+    int tiles = 0;
+    double seconds = 0.0;
+
+    double reduction() const { return tinTriangles ? double(gridTriangles) / tinTriangles : 0.0; }
+};
+
+// Greedy-insertion Delaunay simplifier (Garland & Heckbert 1995), ported from
+// Mapbox's Delatin (https://github.com/mapbox/delatin, ISC licence; the notice
+// is at the top of TerrainTIN.cpp). Starts from the two corner triangles and
+// keeps inserting the sample with the largest vertical error until every
+// sample is within maxError of the surface.
+//
+// With lockBorder set, samples on the tile edge are never picked as
+// candidates; the caller inserts the edge vertices up front with
+// insertBorderPoint so neighbouring tiles share them exactly.
+class TinTriangulator {
+public:
+    std::vector<int> coords;
+    std::vector<unsigned int> triangles;
+
+    // data points at sample (0, 0) of a w x h window inside a row-major
+    // buffer that is `stride` samples wide
+    TinTriangulator(const float* data, int w, int h, int stride, bool lockBorder = false);
+
+    void insertBorderPoint(int x, int y);
+    void run(float maxError);
+    float maxError();
+
+private:
+    const float* data;
+    int w, h, stride;
+    bool lockBorder;
+
+    std::vector<int> halfedges;
+    std::vector<int> candidates;
+    std::vector<int> queueIndices;
+    std::vector<int> queue;
+    std::vector<float> errors;
+    std::vector<int> pending;
+
+    float heightAt(int x, int y) const { return data[y * stride + x]; }
+    int addPoint(int x, int y);
+    int addTriangle(int a, int b, int c, int ab, int bc, int ca, int e = -1);
+    void flush();
+    void findCandidate(int t);
+    void split(int t, int px, int py);
+    void legalize(int a);
+    void handleCollinear(int pn, int a);
+
+    void queuePush(int t, float error);
+    int queuePop();
+    int queuePopBack();
+    void queueRemove(int t);
+    bool queueLess(int i, int j) const { return errors[i] > errors[j]; }
+    void queueSwap(int i, int j);
+    void queueUp(int j);
+    bool queueDown(int i, int n);
+};
+
+// Simplifies the whole heightmap as a single triangulation.
+TinMesh buildTIN(const std::vector<std::vector<float>>& heightMap, float maxError, TinReport* report = nullptr);
+
+// Splits the heightmap into tileCells x tileCells tiles and simplifies them as
+// parallel jobs. Tile edges are simplified once in 1D and locked, so the
+// merged mesh is watertight and every sample still respects maxError.
+TinMesh buildTINTiled(const std::vector<std::vector<float>>& heightMap, float maxError, int tileCells,
+    TinReport* report = nullptr);
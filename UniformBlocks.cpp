@@ -0,0 +1,21 @@
+#include "UniformBlocks.h"
+#include <iostream>
+
+void bindUniformBlock(GLuint program, const char* blockName, GLuint binding) {
+    GLuint index = glGetUniformBlockIndex(program, blockName);
+    if (index == GL_INVALID_INDEX) {
+        std::cerr << "Uniform block " << blockName << " not found in program " << program << std::endl;
+        return;
+    }
+    glUniformBlockBinding(program, index, binding);
+}
+
+size_t uniformBufferAlignment() {
+    static size_t alignment = 0;
+    if (alignment == 0) {
+        GLint value = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &value);
+        alignment = value > 0 ? (size_t)value : 256;
+    }
+    return alignment;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "StreamBuffer.h"
+#include <glad/gl.h>
+#include <glm.hpp>
+#include <cstddef>
+#include <cstring>
+
+// C++ mirrors of the std140 uniform blocks the terrain shaders declare. Only
+// vec4/mat4 members are used, so std140 and C++ agree without padding rules;
+// the asserts catch anyone who adds a vec3 or a scalar array.
+
+const GLuint FRAME_UNIFORM_BINDING = 0;
+const GLuint DRAW_UNIFORM_BINDING = 1;
+
+// layout(std140) uniform Frame, bound once per frame
+struct FrameUniforms {
+    glm::mat4 mvp;
+    glm::vec4 cameraPos;            // xyz, w unused
+};
+static_assert(offsetof(FrameUniforms, cameraPos) == 64, "std140 mismatch");
+static_assert(sizeof(FrameUniforms) == 80, "std140 mismatch");
+
+// layout(std140) uniform TerrainGrid, per patch draw
+struct TerrainGridUniforms {
+    glm::vec4 grid;                 // last cell index x/z, spacing, unused
+};
+static_assert(sizeof(TerrainGridUniforms) == 16, "std140 mismatch");
+
+// layout(std140) uniform CDLODDraw, per CDLOD draw
+struct CDLODUniforms {
+    static const int MAX_LODS = 16;
+    glm::vec4 grid;                 // last cell index x/z, spacing, unused
+    glm::vec4 morphConsts[MAX_LODS];// morph start, 1 / morph length, unused
+};
+static_assert(offsetof(CDLODUniforms, morphConsts) == 16, "std140 mismatch");
+static_assert(sizeof(CDLODUniforms) == 16 + 16 * CDLODUniforms::MAX_LODS, "std140 mismatch");
+
+// layout(std140) uniform ClipmapLevel, per clipmap level draw
+struct ClipmapLevelUniforms {
+    glm::vec4 originScale;          // origin x/z, levelScale, level
+    glm::vec4 params;               // spacing, ringSize, halfExtent, transitionWidth
+    glm::ivec4 flags;               // hasCoarser, unused
+};
+static_assert(offsetof(ClipmapLevelUniforms, params) == 16, "std140 mismatch");
+static_assert(offsetof(ClipmapLevelUniforms, flags) == 32, "std140 mismatch");
+static_assert(sizeof(ClipmapLevelUniforms) == 48, "std140 mismatch");
+
+// Points the named block of program at a binding index
+void bindUniformBlock(GLuint program, const char* blockName, GLuint binding);
+
+// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, queried once
+size_t uniformBufferAlignment();
+
+// Copies block into the streaming ring and binds that range to binding.
+// Returns false, leaving the previous binding, if the ring is full.
+template <typename T>
+bool pushUniformBlock(StreamBuffer& stream, GLuint binding, const T& block) {
+    size_t offset = 0;
+    void* dst = stream.map(sizeof(T), uniformBufferAlignment(), offset);
+    if (!dst)
+        return false;
+    std::memcpy(dst, &block, sizeof(T));
+    stream.unmap();
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, stream.buffer, (GLintptr)offset, sizeof(T));
+    return true;
+}
@@ -1,5 +1,6 @@
 ﻿// terrain_strip_mesh.cpp
 // Compile with: g++ terrain_strip_mesh.cpp -lglfw -ldl -lGL -lX11 -lpthread -lXrandr -lXi -lm
+// Headless runs (--headless, see parseRunOptions) also need -lEGL
 
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
@@ -7,16 +8,68 @@
 #include <gtc/matrix_transform.hpp>
 #include <gtc/type_ptr.hpp>
 #include <vector>
+#include <thread>
 #include <cmath>
 #include <iostream>
 #include <chrono>
 #include <algorithm>
-#include <functional>
+#include <sstream>
+#include <string>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include "Shader.h"
+#include "ProgramCache.h"
+#include "Frustum.h"
+#include "CDLODQuadtree.h"
+#include "CDLODRenderer.h"
+#include "GeometryClipmap.h"
+#include "ClipmapRenderer.h"
+#include "TerrainTIN.h"
+#include "TerrainChunks.h"
+#include "OcclusionBuffer.h"
+#include "ChunkBuilder.h"
+#include "ChunkUploader.h"
+#include "StreamBuffer.h"
+#include "PatchRenderer.h"
+#include "MultiDrawSubmitter.h"
+#include "GLStateCache.h"
+#include "RenderQueue.h"
+#include "UniformBlocks.h"
+#include "HeadlessContext.h"
+#include "RecordingGL.h"
+#include "Profiler.h"
+#include "FixedTimestep.h"
+#include "FramePipeline.h"
+#include "JobSystem.h"
+#include "Benchmarks.h"
+#include "SelfTests.h"
+#include "AllocationCheck.h"
+#include "FrameArena.h"
+#include "CapsuleCollider.h"
+#include "CapsuleWorld.h"
+#include "CapsuleBroadphase.h"
+#include "OffscreenTarget.h"
+#include "ImageWriter.h"
+#include "FrameTimeStats.h"
 
 glm::mat4 model;
 
 const int WIDTH = 1600, HEIGHT = 900;
 const int GRID_W = 256, GRID_H = 256;
+const float FOV_Y = 45.0f, NEAR_PLANE = 0.1f, FAR_PLANE = 1000.0f;
+const float CDLOD_PIXEL_ERROR = 6.0f; // max projected vertical error, in pixels
+const float TIN_MAX_ERROR = 1.0f;     // max vertical error of the simplified static mesh
+const int TIN_TILE_CELLS = 64;
+const int CHUNK_CELLS = 32;
+const int PATCH_SIZE = 32;            // quads per side of the shared instanced patch
+const int OCCLUSION_W = 256, OCCLUSION_H = 128;
+const int OCCLUDER_MIP_LEVEL = 2;     // min-pyramid level the occluder grid is built from
+const size_t CHUNK_UPLOAD_BUDGET_BYTES = 256 * 1024;
+const float CHUNK_UPLOAD_BUDGET_MS = 1.0f;
+const size_t STREAM_BUFFER_BYTES = 4 * 1024 * 1024; // ring for per-frame uploads, several frames deep
+
+enum class TerrainMode { Strips, CDLOD, Clipmap, TIN, Chunks, Patches };
 
 float yaw = -90.0f, pitch = 0.0f;
 float lastX = WIDTH / 2.0f, lastY = HEIGHT / 2.0f;
@@ -46,14 +99,16 @@ std::vector<std::vector<float>> heightMap;
 
 void generateHeightMap(int w, int h, float scale) {
     heightMap.resize(h);
-    for (int y = 0; y < h; ++y) {
-        heightMap[y].resize(w);
-        for (int x = 0; x < w; ++x) {
-            float hNoise = fractalNoise(x * scale, y * scale);
-            float height = (hNoise - 0.5f) * 50.0f;  // height range [-2.5, +2.5]
-            heightMap[y][x] = height;
+    JobSystem::instance().parallelFor(0, h, 16, [&](size_t y0, size_t y1) {
+        for (size_t y = y0; y < y1; ++y) {
+            heightMap[y].resize(w);
+            for (int x = 0; x < w; ++x) {
+                float hNoise = fractalNoise(x * scale, y * scale);
+                float height = (hNoise - 0.5f) * 50.0f;  // height range [-2.5, +2.5]
+                heightMap[y][x] = height;
+            }
         }
-    }
+    });
 }
 
 void generateVertices(std::vector<float>& verts, int w, int h, float scale) {
@@ -69,16 +124,22 @@ void generateVertices(std::vector<float>& verts, int w, int h, float scale) {
     }
 }
 
-void generateIndices(std::vector<std::vector<unsigned int>>& strips, int w, int h) {
+// One triangle strip per grid row, written straight into a single index
+// list; stripOffsets/stripCounts locate each strip in it
+void generateIndices(std::vector<unsigned int>& indices, std::vector<GLuint>& stripOffsets,
+    std::vector<GLsizei>& stripCounts, int w, int h) {
+    indices.reserve(size_t(h - 1) * w * 2);
+    stripOffsets.reserve(h - 1);
+    stripCounts.reserve(h - 1);
     for (int y = 0; y < h - 1; y++) {
-        std::vector<unsigned int> strip;
+        stripOffsets.push_back((GLuint)indices.size());
         for (int x = 0; x < w; ++x) {
             int v0 = y * w + x;
             int v1 = (y + 1) * w + x;
-            strip.push_back(v0);
-            strip.push_back(v1);
+            indices.push_back(v0);
+            indices.push_back(v1);
         }
-        strips.push_back(strip);
+        stripCounts.push_back(GLsizei(w * 2));
     }
 }
 float getInterpolatedHeight(float x, float z) {
@@ -111,7 +172,10 @@ const char* vertSrc = R"(
 #version 330 core
 layout(location = 0) in vec3 position;
 out float vHeight;
-uniform mat4 mvp;
+layout(std140) uniform Frame {
+    mat4 mvp;
+    vec4 cameraPos;
+};
 void main() {
     gl_Position = mvp * vec4(position, 1.0);
     vHeight = position.y;
@@ -136,109 +200,6 @@ void main() {
     fragColor = vec4(color, 1.0);
 })";
 
-GLuint compileShader(GLenum type, const char* src) {
-    GLuint s = glCreateShader(type);
-    glShaderSource(s, 1, &src, nullptr);
-    glCompileShader(s);
-
-    int success;
-    glGetShaderiv(s, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        char log[512];
-        glGetShaderInfoLog(s, 512, nullptr, log);
-        std::cerr << "Shader compile error:\n" << log << "\n";
-    }
-    return s;
-}
-
-
-float getHeight(float x, float z) {
-    const float spacing = 10.0f; // Must match vertex spacing
-
-    int gridX = static_cast<int>(x / spacing);
-    int gridZ = static_cast<int>(z / spacing);
-
-    // Clamp to bounds
-    gridX = std::clamp(gridX, 0, GRID_W - 1);
-    gridZ = std::clamp(gridZ, 0, GRID_H - 1);
-
-    return heightMap[gridZ][gridX];
-}
-
-
-class CapsuleCollider {
-public:
-    float posX, posY, posZ;
-    float velocityY;
-    float capsuleRadius;
-    bool onGround;
-    bool clamped;
-    // Add these:
-    float height;
-    const float gravity = -9.8f;
-    const float groundEpsilon = 0.001f;
-
-    CapsuleCollider(float x, float y, float z, float height, float radius)
-        : posX(x), posY(y), posZ(z), height(height), capsuleRadius(radius),
-        velocityY(0), onGround(false), clamped(false) {
-    }
-
-    void update(float dt, std::function<float(float, float)> getTerrainHeight) {
-        // Gravity
-        velocityY += gravity * dt;
-
-        // Predict vertical position
-        float newY = posY + velocityY * dt;
-
-        // Terrain height at (x, z)
-        float terrainY = getTerrainHeight(posX, posZ);
-        float capsuleBottom = newY - height / 2.0f;
-
-        if (capsuleBottom <= terrainY) {
-            // Landed on terrain
-            newY = terrainY + height / 2.f;
-            velocityY = 0.0f;
-        }
-
-        posY = newY;
-    }
-
-    //void update(float deltaTime, std::function<float(float, float)> getTerrainHeightAt) {
-    //    if (!onGround) {
-    //        velocityY += gravity * deltaTime;
-    //        posY += velocityY * deltaTime;
-
-    //        float terrainY = getHeight(posX, posZ);
-    //        float capsuleBottom = posY - height / 2.0f;
-
-    //        if (capsuleBottom < terrainY) {
-    //            posY = terrainY + height / 2.0f;
-    //            velocityY = 0.0f; // stop falling
-    //        }
-    //        float distToGround = capsuleBottom - terrainY;
-
-    //        if (distToGround < groundEpsilon) {
-    //            posY = terrainY + capsuleRadius + groundEpsilon;
-    //            velocityY = 0;
-    //            onGround = true;
-    //            clamped = true;
-    //        }
-    //        else {
-    //            onGround = false;
-    //            clamped = false;
-    //        }
-    //    }
-    //    else {
-    //        velocityY = 0;
-    //    }
-    //}
-
-    void moveHorizontal(float dx, float dz) {
-        posX += dx;
-        posZ += dz;
-    }
-};
-
 class Camera {
 public:
     glm::vec3 position;
@@ -254,10 +215,15 @@ public:
     }
 
     void followCapsule(const CapsuleCollider& capsule, float eyeOffset) {
+        followPosition(glm::vec3(capsule.posX, capsule.posY, capsule.posZ), capsule.capsuleRadius, eyeOffset);
+    }
+
+    // For an interpolated capsule position between simulation ticks
+    void followPosition(const glm::vec3& capsulePos, float capsuleRadius, float eyeOffset) {
         position = glm::vec3(
-            capsule.posX,
-            capsule.posY + capsule.capsuleRadius + eyeOffset,
-            capsule.posZ
+            capsulePos.x,
+            capsulePos.y + capsuleRadius + eyeOffset,
+            capsulePos.z
         );
     }
 };
@@ -288,30 +254,203 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
 }
 
 glm::vec3 findSpawnPoint(const std::vector<std::vector<float>>& heightMap, float spacing, float capsuleHeight, float capsuleRadius);
+bool checkStaticFrame(const GLRecordStats& frame, size_t expectedDraws);
 
-int main() {
-    if (!glfwInit()) {
-        std::cerr << "Failed to initialize GLFW\n";
-        return -1;
+// Mode keys and WASD movement; moveDir is left unnormalized
+void processInput(GLFWwindow* win, TerrainMode& terrainMode, glm::vec3& moveDir) {
+    if (glfwGetKey(win, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+        glfwSetWindowShouldClose(win, GLFW_TRUE);
     }
-    GLFWwindow* win = glfwCreateWindow(WIDTH, HEIGHT, "Terrain Strip Mesh", nullptr, nullptr);
-    if (!win) {
-        std::cerr << "Failed to create GLFW window\n";
-        glfwTerminate();
-        return -1;
+    if (glfwGetKey(win, GLFW_KEY_1) == GLFW_PRESS)
+        terrainMode = TerrainMode::Strips;
+    if (glfwGetKey(win, GLFW_KEY_2) == GLFW_PRESS)
+        terrainMode = TerrainMode::CDLOD;
+    if (glfwGetKey(win, GLFW_KEY_3) == GLFW_PRESS)
+        terrainMode = TerrainMode::Clipmap;
+    if (glfwGetKey(win, GLFW_KEY_4) == GLFW_PRESS)
+        terrainMode = TerrainMode::TIN;
+    if (glfwGetKey(win, GLFW_KEY_5) == GLFW_PRESS)
+        terrainMode = TerrainMode::Chunks;
+    if (glfwGetKey(win, GLFW_KEY_6) == GLFW_PRESS)
+        terrainMode = TerrainMode::Patches;
+
+    if (glfwGetKey(win, GLFW_KEY_W) == GLFW_PRESS)
+        moveDir += glm::vec3(cameraFront.x, 0, cameraFront.z);
+    if (glfwGetKey(win, GLFW_KEY_S) == GLFW_PRESS)
+        moveDir -= glm::vec3(cameraFront.x, 0, cameraFront.z);
+    if (glfwGetKey(win, GLFW_KEY_A) == GLFW_PRESS)
+        moveDir -= glm::normalize(glm::cross(cameraFront, cameraUp));
+    if (glfwGetKey(win, GLFW_KEY_D) == GLFW_PRESS)
+        moveDir += glm::normalize(glm::cross(cameraFront, cameraUp));
+}
+
+// Frames are built in two stages. The render thread samples input and hands
+// it to the simulation stage, which moves the player and picks what's
+// visible; the snapshot it returns is everything the render stage reads.
+struct InputState {
+    glm::vec3 moveDir = glm::vec3(0.0f);
+    glm::vec3 viewDir = glm::vec3(0, 0, -1);
+    TerrainMode mode = TerrainMode::CDLOD;
+    float dt = 0.0f;
+    uint64_t sampledNs = 0;     // Profiler clock, for input-to-present latency
+};
+
+struct FrameSnapshot {
+    TerrainMode mode = TerrainMode::CDLOD;
+    glm::mat4 mvp = glm::mat4(1.0f);
+    glm::vec3 cameraPos = glm::vec3(0.0f);
+    CDLODSelection cdlod;
+    std::vector<int> visibleChunks;
+    ChunkCullStats chunkStats;
+    float cullMs = 0.0f;
+    uint64_t inputSampledNs = 0;
+};
+
+// Command line. Headless runs render a fixed number of frames into an FBO
+// with a fixed time step, so benchmarks and image dumps are reproducible.
+struct RunOptions {
+    bool headless = false;
+    bool mockGL = false;        // headless on RecordingGL: counts GL work, draws nothing
+    bool checkGL = false;       // mock GL, failing the run if the last frame breaks the static-frame invariants
+    int frames = 300;
+    TerrainMode mode = TerrainMode::CDLOD;
+    std::string dumpDir;        // empty: no frame dumps
+    int dumpEvery = 0;          // 0: last frame only
+    bool dumpPNG = true;
+    bool profile = false;       // print per-zone timings
+    std::string tracePath;      // empty: no Chrome trace
+    float tickRate = 60.0f;     // simulation ticks per second
+    bool pipelined = true;      // simulation on its own thread, one frame ahead
+    std::string benchmark;      // run this microbenchmark and exit
+    std::string selfTest;       // run this self-test, or all, and exit
+    bool allocCheck = false;    // abort if a frame allocates after warm-up
+    int agents = 0;             // wandering capsules simulated alongside the player
+};
+
+bool parseRunOptions(int argc, char** argv, RunOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--headless")
+            options.headless = true;
+        else if (arg == "--mock-gl")
+            options.headless = options.mockGL = true;
+        else if (arg == "--check-gl")
+            options.headless = options.mockGL = options.checkGL = true;
+        else if (arg == "--frames" && hasValue)
+            options.frames = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--mode" && hasValue) {
+            int m = std::atoi(argv[++i]);
+            if (m < 1 || m > 6) {
+                std::cerr << "--mode takes 1-6, the same as the mode keys\n";
+                return false;
+            }
+            options.mode = (TerrainMode)(m - 1);
+        }
+        else if (arg == "--dump" && hasValue)
+            options.dumpDir = argv[++i];
+        else if (arg == "--dump-every" && hasValue)
+            options.dumpEvery = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--ppm")
+            options.dumpPNG = false;
+        else if (arg == "--profile")
+            options.profile = true;
+        else if (arg == "--trace" && hasValue)
+            options.tracePath = argv[++i];
+        else if (arg == "--bench" && hasValue)
+            options.benchmark = argv[++i];
+        else if (arg == "--self-test" && hasValue)
+            options.selfTest = argv[++i];
+        else if (arg == "--agents" && hasValue)
+            options.agents = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--alloc-check")
+            options.allocCheck = true;
+        else if (arg == "--serial")
+            options.pipelined = false;
+        else if (arg == "--tick-rate" && hasValue)
+            options.tickRate = std::clamp((float)std::atof(argv[++i]), 1.0f, 1000.0f);
+        else {
+            std::cerr << "Unknown option " << arg << "\n"
+                << "Usage: LotusVale [--headless] [--mock-gl] [--check-gl] [--frames N] [--mode 1-6] [--dump DIR] [--dump-every N] [--ppm] [--profile] [--trace FILE] [--tick-rate HZ] [--serial] [--bench NAME] [--self-test NAME] [--alloc-check] [--agents N]\n";
+            return false;
+        }
     }
-    glfwMakeContextCurrent(win);
-    if (!gladLoadGL(glfwGetProcAddress)) {
-        std::cerr << "Failed to initialize GLAD\n";
-        glfwDestroyWindow(win);
-        glfwTerminate();
+    return true;
+}
+
+int main(int argc, char** argv) {
+    RunOptions options;
+    if (!parseRunOptions(argc, argv, options))
         return -1;
+
+    // Noise, meshing, TIN tiling and chunk builds all run as jobs
+    JobSystem::instance().start();
+    if (!options.benchmark.empty()) {
+        bool ran = runBenchmark(options.benchmark);
+        JobSystem::instance().stop();
+        return ran ? 0 : -1;
+    }
+    if (!options.selfTest.empty()) {
+        bool passed = runSelfTest(options.selfTest);
+        JobSystem::instance().stop();
+        return passed ? 0 : -1;
+    }
+
+    GLFWwindow* win = nullptr;
+    HeadlessContext headless;
+    OffscreenTarget offscreen;
+    if (options.mockGL) {
+        if (!RecordingGL::instance().install()) {
+            std::cerr << "Failed to initialize GLAD\n";
+            return -1;
+        }
+        offscreen.init(WIDTH, HEIGHT);
+        std::cout << "Headless: " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << "\n";
+    }
+    else if (options.headless) {
+        if (!headless.create())
+            return -1;
+        if (!gladLoadGL(HeadlessContext::getProcAddress)) {
+            std::cerr << "Failed to initialize GLAD\n";
+            headless.destroy();
+            return -1;
+        }
+        if (!offscreen.init(WIDTH, HEIGHT)) {
+            headless.destroy();
+            return -1;
+        }
+        std::cout << "Headless: " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << "\n";
+    }
+    else {
+        if (!glfwInit()) {
+            std::cerr << "Failed to initialize GLFW\n";
+            return -1;
+        }
+        win = glfwCreateWindow(WIDTH, HEIGHT, "Terrain Strip Mesh", nullptr, nullptr);
+        if (!win) {
+            std::cerr << "Failed to create GLFW window\n";
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(win);
+        if (!gladLoadGL(glfwGetProcAddress)) {
+            std::cerr << "Failed to initialize GLAD\n";
+            glfwDestroyWindow(win);
+            glfwTerminate();
+            return -1;
+        }
+        glfwSwapInterval(1);
+        glfwSetCursorPosCallback(win, mouse_callback);
+        glfwSetInputMode(win, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     }
 
     glEnable(GL_DEPTH_TEST);
-    glfwSwapInterval(1);
-    glfwSetCursorPosCallback(win, mouse_callback);
-    glfwSetInputMode(win, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    Profiler& profiler = Profiler::instance();
+    profiler.setThreadName("Main");
+    profiler.initGpu();
+    if (!options.tracePath.empty())
+        profiler.startCapture();
 
     // Generate heightmap ONCE at startup
     generateHeightMap(GRID_W, GRID_H, 0.15f);
@@ -322,18 +461,10 @@ int main() {
 
 
     
-    std::vector<std::vector<unsigned int>> strips;
-    generateIndices(strips, GRID_W, GRID_H);
-
-    // Flatten all strips into one big index vector and store offsets
     std::vector<unsigned int> allIndices;
     std::vector<GLuint> stripOffsets;
-    unsigned int offset = 0;
-    for (const auto& strip : strips) {
-        allIndices.insert(allIndices.end(), strip.begin(), strip.end());
-        stripOffsets.push_back(offset);
-        offset += (GLuint)strip.size();
-    }
+    std::vector<GLsizei> stripCounts;
+    generateIndices(allIndices, stripOffsets, stripCounts, GRID_W, GRID_H);
 
     GLuint vao, vbo, ebo;
     glGenVertexArrays(1, &vao);
@@ -351,22 +482,120 @@ int main() {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, allIndices.size() * sizeof(unsigned int), allIndices.data(), GL_STATIC_DRAW);
 
-    GLuint vs = compileShader(GL_VERTEX_SHADER, vertSrc);
-    GLuint fs = compileShader(GL_FRAGMENT_SHADER, fragSrc);
-    GLuint prog = glCreateProgram();
-    glAttachShader(prog, vs);
-    glAttachShader(prog, fs);
-    glLinkProgram(prog);
-    glDeleteShader(vs);
-    glDeleteShader(fs);
-
-    glm::mat4 proj = glm::perspective(glm::radians(45.0f), WIDTH / (float)HEIGHT, 0.1f, 1000.0f);
+    // Every program is compiled in one batch up front, or loaded from the
+    // binary cache when this driver has seen the same sources before
+    auto shaderStart = std::chrono::steady_clock::now();
+    ProgramCache programCache;
+    programCache.init();
+    programCache.precompile({
+        { vertSrc, fragSrc },
+        { cdlodVertSrc, fragSrc },
+        { clipmapVertSrc, fragSrc },
+        { patchVertSrc, fragSrc },
+    });
+
+    GLuint prog = programCache.get(vertSrc, fragSrc);
+
+    glm::mat4 proj = glm::perspective(glm::radians(FOV_Y), WIDTH / (float)HEIGHT, NEAR_PLANE, FAR_PLANE);
     glm::mat4 view = glm::lookAt(glm::vec3(32, 60, 80), glm::vec3(32, 0, 32), glm::vec3(0, 1, 0));
     model = glm::mat4(1.0f);
     glm::mat4 mvp = proj * view * model;
 
-    GLint mvpLoc = glGetUniformLocation(prog, "mvp");
+    bindUniformBlock(prog, "Frame", FRAME_UNIFORM_BINDING);
+
+    // Per-frame dynamic data (instances, streamed meshes) is sub-allocated
+    // from one fenced ring instead of reallocating buffers
+    StreamBuffer streamBuffer;
+    streamBuffer.init(STREAM_BUFFER_BYTES);
+
+    // CDLOD: quadtree selection on the CPU, one instanced patch on the GPU
+    CDLODQuadtree cdlodTree(heightMap, 10.0f);
+    cdlodTree.computeLodRanges(CDLOD_PIXEL_ERROR, (float)HEIGHT, glm::radians(FOV_Y), FAR_PLANE);
+    CDLODRenderer cdlodRenderer;
+    cdlodRenderer.init(cdlodTree, heightMap, programCache.get(cdlodVertSrc, fragSrc));
+
+    // Geometry clipmaps: camera-centered rings, scrolled toroidally
+    GeometryClipmap clipmap([](int x, int z) {
+        return heightMap[std::clamp(z, 0, GRID_H - 1)][std::clamp(x, 0, GRID_W - 1)];
+    }, 10.0f);
+    ClipmapRenderer clipmapRenderer;
+    clipmapRenderer.init(clipmap, programCache.get(clipmapVertSrc, fragSrc));
+
+    // Error-bounded irregular triangulation for static terrain
+    TinReport tinReport;
+    TinMesh tin = buildTINTiled(heightMap, TIN_MAX_ERROR, TIN_TILE_CELLS, &tinReport);
+    std::cout << "TIN: " << tinReport.gridTriangles << " -> " << tinReport.tinTriangles << " triangles ("
+        << tinReport.reduction() << "x fewer) at max error " << TIN_MAX_ERROR << ", "
+        << tinReport.tiles << " tiles in " << tinReport.seconds * 1000.0 << " ms\n";
+
+    std::vector<float> tinVerts;
+    for (size_t i = 0; i < tin.coords.size(); i += 2) {
+        int x = tin.coords[i], z = tin.coords[i + 1];
+        tinVerts.push_back(x * 10.0f);
+        tinVerts.push_back(heightMap[z][x]);
+        tinVerts.push_back(z * 10.0f);
+    }
 
+    GLuint tinVao, tinVbo, tinEbo;
+    glGenVertexArrays(1, &tinVao);
+    glGenBuffers(1, &tinVbo);
+    glGenBuffers(1, &tinEbo);
+    glBindVertexArray(tinVao);
+    glBindBuffer(GL_ARRAY_BUFFER, tinVbo);
+    glBufferData(GL_ARRAY_BUFFER, tinVerts.size() * sizeof(float), tinVerts.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, tinEbo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, tin.triangles.size() * sizeof(unsigned int), tin.triangles.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+
+    // Full-resolution chunks, frustum and software-occlusion culled
+    HeightfieldMinMax terrainMinMax(heightMap);
+    std::vector<TerrainChunk> chunks = buildTerrainChunks(terrainMinMax, 10.0f, CHUNK_CELLS);
+
+    // Meshes are built as jobs and streamed in under a budget
+    ChunkUploader chunkUploader;
+    chunkUploader.init(chunks, CHUNK_CELLS);
+    ChunkBuilder chunkBuilder(heightMap, chunks, 10.0f);
+    for (int i = 0; i < (int)chunks.size(); ++i)
+        chunkBuilder.request(i);
+
+    // Visible resident chunks are drawn with one multi-draw call
+    MultiDrawSubmitter chunkSubmitter;
+    chunkSubmitter.init();
+    std::vector<DrawElementsIndirectCommand> chunkCommands;
+    IndirectStats chunkDrawStats;
+
+    // Same tiles, drawn as one instanced patch with heights from a texture
+    PatchRenderer patchRenderer;
+    patchRenderer.init(heightMap, 10.0f, CHUNK_CELLS, PATCH_SIZE, programCache.get(patchVertSrc, fragSrc));
+
+    std::cout << "Programs: " << programCache.hits << " from cache, " << programCache.misses << " compiled";
+    if (!programCache.binarySupported())
+        std::cout << " (no program binary support)";
+    std::cout << " in " << std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - shaderStart).count()
+        << " ms\n";
+
+    TerrainOccluders terrainOccluders(terrainMinMax, 10.0f, OCCLUDER_MIP_LEVEL);
+    OcclusionBuffer occlusionBuffer(OCCLUSION_W, OCCLUSION_H);
+
+    // All per-frame binds go through the state cache; draws are queued and
+    // sorted so items sharing state don't rebind it
+    GLStateCache renderState;
+    RenderQueue renderQueue;
+    FrameArena frameArena;
+    auto queueDraw = [&](GLuint program, GLuint vertexArray, GLenum textureTarget, GLuint texture, auto draw) {
+        RenderItem item;
+        item.key = makeSortKey(program, vertexArray, texture, 0.0f);
+        item.program = program;
+        item.vao = vertexArray;
+        item.textureTarget = textureTarget;
+        item.texture = texture;
+        renderQueue.push(item, frameArena, std::move(draw));
+    };
+
+    TerrainMode terrainMode = options.mode;
+    float statsTimer = 0.0f;
    
 
    
@@ -398,60 +627,422 @@ int main() {
         playerCapsule.posZ
     );
     cameraFront = glm::normalize(lookAt - playerCamera.position);
-    while (!glfwWindowShouldClose(win)) {
-        glClearColor(0.1f, 0.1f, 0.1f, 1);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glUseProgram(prog);
+    // The capsule moves in fixed ticks; the camera follows a position
+    // interpolated between the last two ticks
+    FixedTimestep simClock(options.tickRate);
+    glm::vec3 previousCapsulePos(playerCapsule.posX, playerCapsule.posY, playerCapsule.posZ);
+    glm::vec3 currentCapsulePos = previousCapsulePos;
+
+    // The player collides with the terrain's triangles
+    HeightGrid terrainGrid(heightMap, 10.0f);
+    TerrainCollider terrainCollider(terrainGrid, terrainMinMax);
+
+    // Server-style load: agents walking in straight lines across the map,
+    // bouncing off its edges and each other, stepped in batches on the same
+    // ticks
+    CapsuleWorld agents;
+    CapsuleBroadphase agentGrid;
+    std::vector<CapsulePair> agentPairs;
+    if (options.agents > 0) {
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        agents.reserve(options.agents);
+        for (int i = 0; i < options.agents; ++i) {
+            float x = unit(rng) * terrainGrid.extentX(), z = unit(rng) * terrainGrid.extentZ();
+            float angle = unit(rng) * 6.2831853f;
+            agents.add(glm::vec3(x, terrainGrid.sample(x, z) + 2.0f, z), 4.0f, 1.0f,
+                glm::vec3(std::cos(angle), 0.0f, std::sin(angle)) * 3.0f);
+        }
+        // Quarter-spacing cells are just wider than an agent
+        agentGrid.init(terrainGrid.extentX(), terrainGrid.extentZ(), terrainGrid.spacing / 4.0f);
+        agentPairs.reserve(size_t(options.agents) * 8);
+    }
+
+    // Simulation stage. Touches only the player, the camera, the CPU culling
+    // state and read-only terrain data, so it can run off the GL thread.
+    auto simulate = [&](const InputState& input, FrameSnapshot& out) {
+        PROFILE_ZONE("Simulate frame");
+        {
+            PROFILE_ZONE("Physics");
+            float speed = 10.0f;
+            float tickDt = simClock.tickSeconds();
+            int ticks = simClock.advance(input.dt);
+            for (int i = 0; i < ticks; ++i) {
+                previousCapsulePos = currentCapsulePos;
+                playerCapsule.move(tickDt, input.moveDir.x * speed * tickDt, input.moveDir.z * speed * tickDt, terrainCollider);
+                currentCapsulePos = glm::vec3(playerCapsule.posX, playerCapsule.posY, playerCapsule.posZ);
+            }
+            if (agents.size() > 0) {
+                // step() and findPairs() split the agents across the job system
+                PROFILE_ZONE("Agents");
+                for (int i = 0; i < ticks; ++i) {
+                    agents.step(tickDt, terrainGrid);
+                    agentGrid.update(agents);
+                    agentGrid.findPairs(agents, agentPairs);
+                    agents.collide(agentPairs);
+                }
+            }
+
+            playerCamera.viewDir = input.viewDir;
+            playerCamera.followPosition(glm::mix(previousCapsulePos, currentCapsulePos, simClock.alpha()),
+                playerCapsule.capsuleRadius, 0.5f);
+        }
+
+        out.mode = input.mode;
+        out.inputSampledNs = input.sampledNs;
+        out.cameraPos = playerCamera.position;
+        out.mvp = proj * playerCamera.getViewMatrix() * model;
+
+        if (out.mode == TerrainMode::CDLOD) {
+            PROFILE_ZONE("CDLOD select");
+            cdlodTree.select(out.cameraPos, Frustum(out.mvp), out.cdlod);
+        }
+        else if (out.mode == TerrainMode::Chunks || out.mode == TerrainMode::Patches) {
+            PROFILE_ZONE("Chunk visibility");
+            auto cullStart = Clock::now();
+            occlusionBuffer.begin(out.mvp);
+            // Rasterized across the job system; testing the few dozen chunk
+            // boxes costs less than handing them out
+            terrainOccluders.render(occlusionBuffer);
+            cullTerrainChunks(chunks, Frustum(out.mvp), &occlusionBuffer, out.visibleChunks, out.chunkStats);
+            out.cullMs = std::chrono::duration<float, std::milli>(Clock::now() - cullStart).count();
+        }
+    };
+
+    auto sampleInput = [&](float dt) {
+        InputState input;
+        if (win)
+            processInput(win, terrainMode, input.moveDir);
+        if (glm::length(input.moveDir) > 0.0f)
+            input.moveDir = glm::normalize(input.moveDir);
+        input.viewDir = cameraFront;
+        input.mode = terrainMode;
+        input.dt = dt;
+        input.sampledNs = Profiler::nowNs();
+        return input;
+    };
+
+    // Pipelined, the simulation thread builds frame N+1 while this thread
+    // submits frame N. Serial runs both stages here, back to back.
+    FramePipeline<InputState> inputs(2);
+    FramePipeline<FrameSnapshot> snapshots(2);
+    FrameSnapshot serialSnapshot;
+    std::thread simThread;
+    auto postInput = [&](const InputState& input) {
+        if (InputState* slot = inputs.acquireWrite()) {
+            *slot = input;
+            inputs.publish(slot);
+        }
+    };
+    if (options.pipelined) {
+        simThread = std::thread([&]() {
+            Profiler::instance().setThreadName("Simulation");
+            checkAllocationsOnThisThread();
+            while (InputState* input = inputs.acquireRead()) {
+                FrameSnapshot* snapshot = snapshots.acquireWrite();
+                if (snapshot) {
+                    simulate(*input, *snapshot);
+                    snapshots.publish(snapshot);
+                }
+                inputs.release(input);
+                if (!snapshot)
+                    break;
+            }
+        });
+        postInput(sampleInput(win ? 0.0f : 1.0f / 60.0f));
+    }
+    std::vector<float> latencyMs;
+    float lastLatencyMs = 0.0f;
+
+    std::vector<float> frameTimesMs;
+    std::vector<unsigned char> framePixels;
+    std::vector<GLRecordStats> frameGLStats;
+    RecordingGL& recorder = RecordingGL::instance();
+    if (options.mockGL) {
+        std::cout << "GL setup: " << recorder.stats.calls << " calls, " << recorder.stats.objectsCreated << " objects, "
+            << recorder.stats.bytesUploaded / 1024 << " KB uploaded\n";
+        recorder.reset();
+    }
+    if (!options.dumpDir.empty())
+        std::filesystem::create_directories(options.dumpDir);
+
+    // Frames after warm-up (streaming done, containers at size) must not
+    // touch the heap on the render or simulation thread
+    const int allocCheckWarmup = win ? 120 : std::min(120, options.frames / 2);
+    if (options.allocCheck && !allocationCheckAvailable())
+        std::cerr << "--alloc-check needs a build with LOTUS_CHECK_ALLOCATIONS\n";
+    checkAllocationsOnThisThread();
+    int exitCode = 0;
+    if (!win) {
+        frameTimesMs.reserve(options.frames);
+        latencyMs.reserve(options.frames);
+        if (options.mockGL)
+            frameGLStats.reserve(options.frames);
+    }
+
+    for (int frame = 0; win ? !glfwWindowShouldClose(win) : frame < options.frames; ++frame) {
+        auto frameStart = Clock::now();
+        uint64_t frameStartNs = Profiler::nowNs();
+        if (options.allocCheck && frame == allocCheckWarmup)
+            armAllocationCheck();
+        {
+            PROFILE_ZONE("Begin frame");
+            glClearColor(0.1f, 0.1f, 0.1f, 1);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            streamBuffer.beginFrame();
+            programCache.pump();
+            renderState.resetStats();
+            renderQueue.clear();
+            frameArena.reset();
+        }
 
         auto currentTime = Clock::now();
         std::chrono::duration<float> elapsed = currentTime - lastTime;
         float dt = elapsed.count(); // dt in seconds as float
-        dt = std::min(dt, 0.05f); // Cap at ~20 FPS time step
         lastTime = currentTime;
+        if (!win)
+            dt = 1.0f / 60.0f;
+
+        // Input for the next frame goes out before this frame is drawn, so
+        // the simulation thread has it while this thread submits
+        InputState input = sampleInput(dt);
+        FrameSnapshot* snapshot = &serialSnapshot;
+        if (options.pipelined) {
+            postInput(input);
+            PROFILE_ZONE("Wait for simulation");
+            snapshot = snapshots.acquireRead();
+        }
+        else {
+            simulate(input, serialSnapshot);
+        }
+        const FrameSnapshot& frameState = *snapshot;
+        mvp = frameState.mvp;
 
-        if (glfwGetKey(win, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-            glfwSetWindowShouldClose(win, GLFW_TRUE);
+        if (frameState.mode == TerrainMode::CDLOD) {
+            queueDraw(cdlodRenderer.program, cdlodRenderer.vao, GL_TEXTURE_2D, cdlodRenderer.heightTex, [&]() {
+                cdlodRenderer.draw(cdlodTree, frameState.cdlod, streamBuffer, renderState);
+            });
+        }
+        else if (frameState.mode == TerrainMode::Clipmap) {
+            PROFILE_ZONE("Clipmap update");
+            clipmap.update(frameState.cameraPos);
+            clipmapRenderer.upload(clipmap, renderState);
+            queueDraw(clipmapRenderer.program, clipmapRenderer.vao, GL_TEXTURE_2D_ARRAY, clipmapRenderer.heightTex, [&]() {
+                clipmapRenderer.draw(clipmap, streamBuffer, renderState);
+            });
+        }
+        else if (frameState.mode == TerrainMode::TIN) {
+            queueDraw(prog, tinVao, GL_TEXTURE_2D, 0, [&]() {
+                glDrawElements(GL_TRIANGLES, (GLsizei)tin.triangles.size(), GL_UNSIGNED_INT, (void*)0);
+            });
+        }
+        else if (frameState.mode == TerrainMode::Patches) {
+            queueDraw(patchRenderer.program, patchRenderer.vao, GL_TEXTURE_2D, patchRenderer.heightTex, [&]() {
+                patchRenderer.draw(chunks, frameState.visibleChunks, streamBuffer, renderState);
+            });
+        }
+        else if (frameState.mode == TerrainMode::Chunks) {
+            {
+                PROFILE_ZONE("Chunk upload");
+                chunkUploader.pump(chunkBuilder, chunks, streamBuffer, renderState, CHUNK_UPLOAD_BUDGET_BYTES, CHUNK_UPLOAD_BUDGET_MS);
+            }
+            buildIndirectCommands(chunks, frameState.visibleChunks, chunkUploader.resident, chunkCommands, chunkDrawStats);
+            queueDraw(prog, chunkUploader.vao, GL_TEXTURE_2D, 0, [&]() {
+                chunkSubmitter.submit(chunkCommands, streamBuffer);
+            });
+        }
+        else {
+            queueDraw(prog, vao, GL_TEXTURE_2D, 0, [&]() {
+                for (size_t i = 0; i < stripCounts.size(); ++i) {
+                    glDrawElements(GL_TRIANGLE_STRIP, stripCounts[i], GL_UNSIGNED_INT, (void*)(stripOffsets[i] * sizeof(unsigned int)));
+                }
+            });
         }
 
-        glm::vec3 moveDir(0.0f);
+        FrameUniforms frameUniforms;
+        frameUniforms.mvp = mvp;
+        frameUniforms.cameraPos = glm::vec4(frameState.cameraPos, 1.0f);
+        pushUniformBlock(streamBuffer, FRAME_UNIFORM_BINDING, frameUniforms);
 
-        if (glfwGetKey(win, GLFW_KEY_W) == GLFW_PRESS)
-            moveDir += glm::vec3(cameraFront.x, 0, cameraFront.z);
-        if (glfwGetKey(win, GLFW_KEY_S) == GLFW_PRESS)
-            moveDir -= glm::vec3(cameraFront.x, 0, cameraFront.z);
-        if (glfwGetKey(win, GLFW_KEY_A) == GLFW_PRESS)
-            moveDir -= glm::normalize(glm::cross(cameraFront, cameraUp));
-        if (glfwGetKey(win, GLFW_KEY_D) == GLFW_PRESS)
-            moveDir += glm::normalize(glm::cross(cameraFront, cameraUp));
+        {
+            PROFILE_ZONE("Submit");
+            PROFILE_GPU_ZONE("Terrain");
+            renderQueue.execute(renderState);
+        }
+        {
+            PROFILE_ZONE("End frame");
+            streamBuffer.endFrame();
+        }
 
-        if (glm::length(moveDir) > 0.0f)
-            moveDir = glm::normalize(moveDir);
+        // Per-mode stats in the title bar, refreshed once a second
+        statsTimer += dt;
+        if (win && statsTimer >= 1.0f) {
+            AllocationCheckPause titleText;
+            statsTimer = 0.0f;
+            std::ostringstream title;
+            title << "Terrain Strip Mesh";
+            if (frameState.mode == TerrainMode::CDLOD) {
+                title << " | CDLOD nodes: " << frameState.cdlod.fullNodes.size() + frameState.cdlod.quarterNodes.size()
+                    << " tris: " << cdlodTree.triangleCount(frameState.cdlod);
+            }
+            else if (frameState.mode == TerrainMode::Clipmap) {
+                title << " | Clipmap finest: " << clipmap.finestActiveLevel()
+                    << " tris: " << clipmapRenderer.lastTriangleCount
+                    << " upload: " << clipmap.lastUploadBytes / 1024 << " KB (peak " << clipmap.peakUploadBytes / 1024
+                    << " / budget " << clipmap.uploadBudgetBytes / 1024 << " KB)";
+            }
+            else if (frameState.mode == TerrainMode::Chunks) {
+                title << " | Chunks visible: " << frameState.chunkStats.visible << "/" << chunks.size()
+                    << " frustum culled: " << frameState.chunkStats.frustumCulled
+                    << " occluded: " << frameState.chunkStats.occlusionCulled
+                    << " cull: " << frameState.cullMs << " ms"
+                    << " | " << (chunkSubmitter.indirect ? "MDI" : "multi-draw") << " commands: " << chunkDrawStats.commands
+                    << " tris: " << chunkDrawStats.triangles
+                    << " | streamed: " << chunkUploader.uploadedChunks << " chunks, "
+                    << chunkUploader.uploadedBytes / 1024 << " KB in " << chunkUploader.uploadMs << " ms";
+            }
+            else if (frameState.mode == TerrainMode::Patches) {
+                title << " | Patches: " << patchRenderer.lastInstanceCount << "/" << chunks.size()
+                    << " tris: " << patchRenderer.lastTriangleCount
+                    << " geometry: " << patchRenderer.geometryBytes() / 1024 << " KB";
+            }
+            else if (frameState.mode == TerrainMode::TIN) {
+                title << " | TIN tris: " << tinReport.tinTriangles << " (" << tinReport.reduction() << "x fewer)";
+            }
+            title << " | sim: " << simClock.tickRate() << " Hz " << (options.pipelined ? "pipelined" : "serial")
+                << ", input latency " << lastLatencyMs << " ms";
+            title << " | state: " << renderState.issued << " set, " << renderState.skipped << " skipped";
+            title << " | ring: " << (streamBuffer.persistent ? "persistent" : "orphaned")
+                << " " << streamBuffer.ring->frameBytes / 1024 << " KB/frame, fence waits: " << streamBuffer.ring->fenceWaits;
+            glfwSetWindowTitle(win, title.str().c_str());
+        }
 
-        float speed = 10.0f;
-        playerCapsule.moveHorizontal(moveDir.x * speed * dt, moveDir.z * speed * dt);
+        if (win) {
+            PROFILE_ZONE("Present");
+            glfwSwapBuffers(win);
+            glfwPollEvents();
+        }
+        else {
+            // Headless: time the frame through GPU completion, then dump it
+            {
+                PROFILE_ZONE("GPU wait");
+                glFinish();
+            }
+            frameTimesMs.push_back(std::chrono::duration<float, std::milli>(Clock::now() - frameStart).count());
+            if (options.mockGL) {
+                frameGLStats.push_back(recorder.stats);
+                recorder.reset();
+            }
+            bool lastFrame = frame == options.frames - 1;
+            if (!options.dumpDir.empty() && (lastFrame || (options.dumpEvery > 0 && frame % options.dumpEvery == 0))) {
+                offscreen.readPixels(framePixels);
+                char name[32];
+                snprintf(name, sizeof(name), "frame_%05d.%s", frame, options.dumpPNG ? "png" : "ppm");
+                std::string path = options.dumpDir + "/" + name;
+                if (options.dumpPNG)
+                    writePNG(path, WIDTH, HEIGHT, framePixels);
+                else
+                    writePPM(path, WIDTH, HEIGHT, framePixels);
+            }
+        }
 
-        // Use bilinear interpolation heightmap query instead of fractalNoise!
-        playerCapsule.update(dt, getHeight);
+        // Input to present: one frame serial, two pipelined
+        lastLatencyMs = (Profiler::nowNs() - frameState.inputSampledNs) * 1e-6f;
+        if (!win)
+            latencyMs.push_back(lastLatencyMs);
+        if (options.pipelined)
+            snapshots.release(snapshot);
+
+        profiler.record("Frame", frameStartNs, Profiler::nowNs());
+        profiler.endFrame();
+        if (win && options.profile && frame % Profiler::HISTORY == Profiler::HISTORY - 1) {
+            AllocationCheckPause summaryText;
+            profiler.printSummary(std::cout);
+        }
+    }
 
-        playerCamera.viewDir = cameraFront;
-        playerCamera.followCapsule(playerCapsule, 0.5f);
+    disarmAllocationCheck();
+    if (options.allocCheck && allocationCheckAvailable())
+        std::cout << "Allocation check: no allocations after frame " << allocCheckWarmup << "\n";
 
-        mvp = proj * playerCamera.getViewMatrix() * model;
-        glUniformMatrix4fv(mvpLoc, 1, GL_FALSE, glm::value_ptr(mvp));
-        glBindVertexArray(vao);
+    if (options.pipelined) {
+        inputs.stop();
+        snapshots.stop();
+        simThread.join();
+    }
 
-        for (size_t i = 0; i < strips.size(); ++i) {
-            glDrawElements(GL_TRIANGLE_STRIP, (GLsizei)strips[i].size(), GL_UNSIGNED_INT, (void*)(stripOffsets[i] * sizeof(unsigned int)));
+    if (!win) {
+        FrameTimeSummary summary = summarizeFrameTimes(frameTimesMs);
+        std::cout << "Frames: " << summary.frames << " | mean " << summary.meanMs << " ms"
+            << " | p50 " << summary.p50Ms << " | p95 " << summary.p95Ms << " | p99 " << summary.p99Ms
+            << " | min " << summary.minMs << " | max " << summary.maxMs << " ms\n";
+        FrameTimeSummary latency = summarizeFrameTimes(latencyMs);
+        std::cout << "Input latency (" << (options.pipelined ? "pipelined" : "serial") << "): p50 " << latency.p50Ms
+            << " | p95 " << latency.p95Ms << " | max " << latency.maxMs << " ms";
+        if (options.pipelined)
+            std::cout << " | render waited on simulation " << snapshots.consumerWaits << " times";
+        std::cout << "\n";
+    }
+    if (options.mockGL) {
+        // Per-frame GL work; the last frame is the steady state for a static camera
+        GLRecordStats total;
+        for (const GLRecordStats& f : frameGLStats) {
+            total.calls += f.calls;
+            total.drawCalls += f.drawCalls;
+            total.stateChanges += f.stateChanges;
+            total.uniformUpdates += f.uniformUpdates;
+            total.bytesUploaded += f.bytesUploaded;
+            total.bytesCopied += f.bytesCopied;
+            total.bytesMapped += f.bytesMapped;
+        }
+        double n = (double)frameGLStats.size();
+        const GLRecordStats& last = frameGLStats.back();
+        std::cout << "GL per frame (mean): " << total.calls / n << " calls, " << total.drawCalls / n << " draws, "
+            << total.stateChanges / n << " state changes, " << total.bytesUploaded / n << " B uploaded, "
+            << total.bytesCopied / n << " B copied, " << total.bytesMapped / n << " B mapped\n";
+        std::cout << "GL last frame: " << last.calls << " calls, " << last.drawCalls << " draws ("
+            << last.indicesSubmitted << " indices), " << last.stateChanges << " state changes, "
+            << last.uniformUpdates << " uniform updates, " << last.bytesUploaded << " B uploaded, "
+            << last.bytesCopied << " B copied, " << last.bytesMapped << " B mapped\n";
+
+        if (options.checkGL) {
+            // The camera never moves headless, so by the last frame every mode
+            // has finished streaming: its terrain goes out in a fixed number of
+            // draws and no geometry or texture data is sent again
+            size_t expectedDraws = 1;
+            if (options.mode == TerrainMode::Strips)
+                expectedDraws = stripCounts.size();
+            else if (options.mode == TerrainMode::Clipmap)
+                expectedDraws = size_t(clipmap.levelCount - clipmap.finestActiveLevel());
+            if (!checkStaticFrame(last, expectedDraws))
+                exitCode = -1;
         }
-
-        glfwSwapBuffers(win);
-        glfwPollEvents();
     }
 
-    glfwDestroyWindow(win);
-    glfwTerminate();
-    return 0;
+    if (!win && options.profile)
+        profiler.printSummary(std::cout);
+    if (!options.tracePath.empty() && profiler.writeChromeTrace(options.tracePath))
+        std::cout << "Trace written to " << options.tracePath << "\n";
+
+    profiler.destroy();
+    cdlodRenderer.destroy();
+    clipmapRenderer.destroy();
+    chunkUploader.destroy();
+    patchRenderer.destroy();
+    streamBuffer.destroy();
+
+    if (win) {
+        glfwDestroyWindow(win);
+        glfwTerminate();
+    }
+    else {
+        offscreen.destroy();
+        headless.destroy();
+    }
+    JobSystem::instance().stop();
+    return exitCode;
 }
 
 
@@ -478,4 +1069,27 @@ glm::vec3 findSpawnPoint(const std::vector<std::vector<float>>& heightMap, float
 
     // Fallback spawn if no flat spot found
     return glm::vec3(0.0f, 50.0f, 0.0f);
-}
\ No newline at end of file
+}
+
+
+// Performance invariants of a steady-state frame, from RecordingGL's counts.
+// Reports each one broken and returns false if any is.
+bool checkStaticFrame(const GLRecordStats& frame, size_t expectedDraws) {
+    bool ok = true;
+    if (frame.drawCalls != expectedDraws) {
+        std::cerr << "GL check: " << frame.drawCalls << " draws for the terrain, expected " << expectedDraws << "\n";
+        ok = false;
+    }
+    if (frame.bytesUploaded != 0 || frame.bytesCopied != 0) {
+        std::cerr << "GL check: static frame uploaded " << frame.bytesUploaded << " B and copied "
+            << frame.bytesCopied << " B, expected none\n";
+        ok = false;
+    }
+    if (frame.uniformUpdates != 0) {
+        std::cerr << "GL check: static frame set " << frame.uniformUpdates << " uniforms, expected none\n";
+        ok = false;
+    }
+    if (ok)
+        std::cout << "GL check: passed\n";
+    return ok;
+}